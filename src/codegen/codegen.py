@@ -2,9 +2,10 @@
 
 from configparser import ConfigParser
 from rich.console import Console
-from rich.prompt import Confirm, Prompt
+from rich.prompt import Confirm, IntPrompt, Prompt
 import os
 from pathlib import Path
+import platform
 import shutil
 import sys
 import signal
@@ -15,7 +16,34 @@ def signal_handler(sig, frame):
 
 console = Console()
 
-def copy_templates_to_experiment(base_path):
+WORKLOAD_BEGIN_MARKER = "// Workload begin"
+WORKLOAD_END_MARKER = "// Workload end"
+
+def get_workloads_path():
+    return Path(__file__).parent.absolute().joinpath("templates", "workloads").resolve()
+
+def load_workload_templates():
+    # Sections of workloads.ini describe the workload templates, in the order they are offered
+    workloads = ConfigParser()
+    workloads.read(get_workloads_path().joinpath("workloads.ini"))
+    return workloads
+
+def splice_workload(benchmark_source, workload_source):
+    # The hooks between the markers are replaced, the comment lines after the begin marker stay
+    begin = benchmark_source.index(WORKLOAD_BEGIN_MARKER)
+    end = benchmark_source.index(WORKLOAD_END_MARKER, begin)
+    start = begin
+    while benchmark_source.startswith("//", start):
+        start = benchmark_source.index("\n", start) + 1
+    return benchmark_source[:start] + "\n" + workload_source.rstrip("\n") + "\n" + benchmark_source[end:]
+
+def default_workload_configurations(workload):
+    # Architecture-specific configurations, e.g. configurations_aarch64, replace the default list
+    machine = platform.machine().lower()
+    value = workload.get(f"configurations_{machine}", workload.get("configurations", "baseline"))
+    return [configuration.strip() for configuration in value.split(',')]
+
+def copy_templates_to_experiment(base_path, workload_name=None):
     script_dir = Path(__file__).parent.absolute()
     templates_path = script_dir.joinpath("templates").resolve()
 
@@ -37,8 +65,13 @@ def copy_templates_to_experiment(base_path):
     benchmark_destination = target_src_path.joinpath("benchmark.c")
     makefile_destination = target_makefile_path.joinpath("Makefile")
 
-    # Copying the template files to the target directory
-    shutil.copy(benchmark_template, benchmark_destination)
+    # Copying the template files to the target directory, with the hooks of the selected workload
+    if workload_name:
+        workload = load_workload_templates()[workload_name]
+        workload_source = get_workloads_path().joinpath(workload["source"]).read_text()
+        benchmark_destination.write_text(splice_workload(benchmark_template.read_text(), workload_source))
+    else:
+        shutil.copy(benchmark_template, benchmark_destination)
     shutil.copy(makefile_template, makefile_destination)
     
     # Copying all notebooks from the template notebooks directory to the target analysis directory
@@ -47,13 +80,21 @@ def copy_templates_to_experiment(base_path):
             if notebook_file.is_file():  # Make sure it's a file
                 shutil.copy(notebook_file, target_analysis_path.joinpath(notebook_file.name))
 
-def create_run_script(base_path, configuration, measurements):
+def create_run_script(base_path, configuration, measurements, cycle_timer=True, latency_batch=1):
     run_script_path = os.path.join(base_path, "scripts", f"run_{configuration}.sh")
     EXPCONFIG = f"-DCONFIG_{configuration.upper()} "
+    if cycle_timer:
+        EXPCONFIG += "-DCONFIG_TIMER_CYCLES "
     if measurements['Throughput']:
         EXPCONFIG += "-DCONFIG_MEASURE_THROUGHPUT "
     if measurements['Latency']:
         EXPCONFIG += "-DCONFIG_MEASURE_LATENCY "
+        if latency_batch > 1:
+            EXPCONFIG += f"-DCONFIG_MEASURE_LATENCY_BATCHED -DLATENCY_BATCH_SIZE={latency_batch} "
+    if measurements['Power']:
+        EXPCONFIG += "-DCONFIG_MEASURE_POWER "
+    if measurements['Perf_Statistics']:
+        EXPCONFIG += "-DCONFIG_MEASURE_PERF "
 
     with open(run_script_path, 'w') as run_script:
         run_script.write(f"""#!/bin/bash
@@ -61,17 +102,26 @@ def create_run_script(base_path, configuration, measurements):
 # Navigate to the experiment's root directory
 cd "$(dirname "$0")/.."
 
-make clean 1>&2
-make EXPCONFIG="{EXPCONFIG}" 1>&2
-      
+# The experiment runner passes --build-only or --run-only to build configurations
+# concurrently before running them, by default the script does both. Builds are
+# cached per set of flags, so an unchanged configuration is not recompiled.
+if [ "$1" != "--run-only" ]; then
+    make CONFIG_NAME="{configuration}" EXPCONFIG="{EXPCONFIG}" 1>&2 || exit 1
+fi
+
+if [ "$1" == "--build-only" ]; then
+    exit 0
+fi
+
 # Run the compiled experiment binary
-cd bin
+export EXPERIMENT_RUN_CONFIGURATION="{configuration}"
+cd bin/{configuration}
 ./benchmark
 """)
     # Make the script executable
     os.chmod(run_script_path, 0o755)
     
-def create_experiment_structure(base_path, measurements, configurations = ['baseline']):
+def create_experiment_structure(base_path, measurements, configurations = ['baseline'], cycle_timer = True, latency_batch = 1, workload_name = None):
     paths = ["config", "data/raw", "data/processed", "scripts", "analysis", "src"]
     for path in paths:
         os.makedirs(os.path.join(base_path, path), exist_ok=True)
@@ -81,25 +131,60 @@ def create_experiment_structure(base_path, measurements, configurations = ['base
     config['Settings'] = {
         'EXPERIMENT_VERSION': '1.0.0',
         'EXPERIMENT_LOOP_COUNT': '100000',
+        'EXPERIMENT_LOOP_CALIBRATION': 'off',
+        'EXPERIMENT_LOOP_MIN_COUNT': '10',
+        'EXPERIMENT_TARGET_TIME': '0.5',
+        'EXPERIMENT_TARGET_ERROR': '0.01',
+        'EXPERIMENT_WARMUP': 'steady',
+        'EXPERIMENT_WARMUP_BATCH_SIZE': '100',
+        'EXPERIMENT_WARMUP_WINDOW': '8',
+        'EXPERIMENT_WARMUP_MAX_BATCHES': '200',
+        'EXPERIMENT_WARMUP_TOLERANCE': '0.02',
         'EXPERIMENT_WORK_MIN_SIZE': '1',
         'EXPERIMENT_WORK_MAX_SIZE': '1',
         'EXPERIMENT_WORK_SIZE_STEP': '1',
+        'EXPERIMENT_WORK_SWEEP': 'linear',
+        'EXPERIMENT_WORK_SIZE_FACTOR': '2',
+        'EXPERIMENT_WORK_SIZES': '',
         'EXPERIMENT_ITERATIONS': '30',
         'EXPERIMENT_CONFIGURATIONS': 'baseline',
         'EXPERIMENT_RUN_ID': '0',
         'EXPERIMENT_RUN_CONFIGURATION': configurations[0],
+        'EXPERIMENT_LATENCY_RAW_SAMPLES': 'false',
+        'EXPERIMENT_LATENCY_PRECISION': '3',
+        'EXPERIMENT_OUTPUT_FORMAT': 'binary',
+        'EXPERIMENT_SAMPLE_PAGES': 'thp',
+        'EXPERIMENT_THREAD_MIN': '1',
+        'EXPERIMENT_THREAD_MAX': '0',
+        'EXPERIMENT_THREAD_STEP': '1',
+        'EXPERIMENT_THREAD_CPUS': '',
+        'EXPERIMENT_POWER_SOURCE': 'auto',
+        'EXPERIMENT_POWER_SIMULATED_WATTS': '50',
+        'EXPERIMENT_ISOLATE': 'false',
+        'EXPERIMENT_SEED': '1',
+        'EXPERIMENT_BYTES_PER_OP': '0',
     }
     config['Settings']['EXPERIMENT_CONFIGURATIONS'] = ', '.join(configurations)
 
+    # Workload templates bring their own sweep and settings, and parameters of their own
+    if workload_name:
+        workload = load_workload_templates()[workload_name]
+        config['Workload'] = {'WORKLOAD_TEMPLATE': workload_name}
+        for key, value in workload.items():
+            if key.startswith('experiment_'):
+                config['Settings'][key] = value
+            elif key.startswith('workload_'):
+                config['Workload'][key] = value
+
     with open(os.path.join(base_path, "config", "config.ini"), 'w') as config_file:
         config.write(config_file)
 
     # Copy the source template files to the experiment directory 
-    copy_templates_to_experiment(base_path)
+    copy_templates_to_experiment(base_path, workload_name)
 
     # Create run scripts for all specified configurations
     for configuration in configurations:
-        create_run_script(base_path, configuration, measurements)
+        create_run_script(base_path, configuration, measurements, cycle_timer, latency_batch)
     
     console.print("Experiment setup complete!", style="bold blue")
     
@@ -119,6 +204,15 @@ def main():
         experiments_dir = script_dir.joinpath("..", "..", "experiments").resolve()
 
     experiment_path = experiments_dir.joinpath(experiment_name)
+
+    # A workload template fills in the benchmark hooks, a blank experiment leaves them empty
+    workloads = load_workload_templates()
+    console.print("Workload templates:", style="bold")
+    console.print("  blank: Empty hooks to fill in")
+    for name in workloads.sections():
+        console.print(f"  {name}: {workloads[name]['description']}")
+    workload_name = Prompt.ask("Select a workload template", choices=["blank"] + workloads.sections(), default="blank")
+    workload = workloads[workload_name] if workload_name != "blank" else None
     
     # Measurement selection through yes/no prompts
     measurements = {
@@ -131,11 +225,22 @@ def main():
     for measurement in measurements:
         measurements[measurement] = Confirm.ask(f"Include {measurement}?", default="y")
 
+    # Operations shorter than the timer are timed in unrolled batches, reporting latency per call
+    latency_batch = 1
+    if measurements["Latency"]:
+        default_batch = workload.getint("latency_batch", 1) if workload else 1
+        latency_batch = IntPrompt.ask("Calls per latency sample (1 times every call individually)", default=default_batch)
+
+    # The cycle counter timer is much cheaper than clock_gettime for short workloads
+    cycle_timer = Confirm.ask("Use the CPU cycle counter for timing (rdtscp/cntvct)?", default="y")
+
     # Ask for a comma-separated list of configurations
-    configurations_input = Prompt.ask("Enter a comma-separated list of configurations the experiment will support", default="baseline")
+    default_configurations = ', '.join(default_workload_configurations(workload)) if workload else "baseline"
+    configurations_input = Prompt.ask("Enter a comma-separated list of configurations the experiment will support", default=default_configurations)
     configurations = [config.strip() for config in configurations_input.split(',')]
 
-    create_experiment_structure(experiment_path, measurements, configurations)
+    create_experiment_structure(experiment_path, measurements, configurations, cycle_timer, latency_batch,
+                                workload_name if workload else None)
 
 if __name__ == "__main__":
     main()
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,153 +8,2305 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <limits.h>
+#include <math.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 
-#define CONFIG_PATH "../config/config.ini"
+#define CONFIG_PATH "config/config.ini"    // Relative to the experiment root directory
+
+// Batched latency times LATENCY_BATCH_SIZE unrolled calls per sample and records the per-call
+// latency in picoseconds, for operations too short to time one at a time. It implies
+// CONFIG_MEASURE_LATENCY, whose histogram and raw sample outputs it uses.
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+#ifndef CONFIG_MEASURE_LATENCY
+#define CONFIG_MEASURE_LATENCY
+#endif
+#ifndef LATENCY_BATCH_SIZE
+#define LATENCY_BATCH_SIZE 16   // Override with -DLATENCY_BATCH_SIZE=<calls>
+#endif
+#define CALLS_PER_ITERATION LATENCY_BATCH_SIZE
+#else
+#define CALLS_PER_ITERATION 1   // Calls of benchmark_function per iteration of the measured loop
+#endif
+
+// Experiment root directory, found by walking up from the benchmark binary
+char   EXPERIMENT_ROOT[PATH_MAX];
 
 // Global configuration variables
 char*  EXPERIMENT_VERSION = NULL;
 int    EXPERIMENT_LOOP_COUNT = 0;
-int    EXPERIMENT_WORK_MIN_SIZE = 0;
-int    EXPERIMENT_WORK_MAX_SIZE = 0;
-int    EXPERIMENT_WORK_SIZE_STEP = 0;
+int    EXPERIMENT_LOOP_MIN_COUNT = 0;
+int    EXPERIMENT_LOOP_CALIBRATION = 0;
+double EXPERIMENT_TARGET_TIME = 0;
+double EXPERIMENT_TARGET_ERROR = 0;
+int    EXPERIMENT_WARMUP = 0;
+int    EXPERIMENT_WARMUP_BATCH_SIZE = 0;
+int    EXPERIMENT_WARMUP_WINDOW = 0;
+int    EXPERIMENT_WARMUP_MAX_BATCHES = 0;
+double EXPERIMENT_WARMUP_TOLERANCE = 0;
+size_t EXPERIMENT_WORK_MIN_SIZE = 0;
+size_t EXPERIMENT_WORK_MAX_SIZE = 0;
+size_t EXPERIMENT_WORK_SIZE_STEP = 0;
+size_t* EXPERIMENT_WORK_SIZES = NULL;     // Every work size of the sweep, in ascending order
+int    EXPERIMENT_WORK_SIZE_COUNT = 0;
 int    EXPERIMENT_RUN_ID = 0;
 char*  EXPERIMENT_CONFIGURATION_NAME = NULL;
+int    EXPERIMENT_LATENCY_RAW_SAMPLES = 0;
+int    EXPERIMENT_OUTPUT_BINARY = 0;
+int    EXPERIMENT_LATENCY_PRECISION = 0;
+int    EXPERIMENT_THREAD_MIN = 0;
+int    EXPERIMENT_THREAD_MAX = 0;
+int    EXPERIMENT_THREAD_STEP = 0;
+char*  EXPERIMENT_THREAD_CPUS = NULL;
+char*  EXPERIMENT_POWER_SOURCE = NULL;
+double EXPERIMENT_POWER_SIMULATED_WATTS = 0;
+int    EXPERIMENT_ISOLATE = 0;
+uint64_t EXPERIMENT_SEED = 0;
+size_t EXPERIMENT_BYTES_PER_OP = 0;
+int    EXPERIMENT_SAMPLE_PAGES = 0;
+
+// Values of EXPERIMENT_LOOP_CALIBRATION and EXPERIMENT_WARMUP, also for use in the workload hooks
+#define LOOP_CALIBRATION_OFF    0
+#define LOOP_CALIBRATION_TIME   1
+#define LOOP_CALIBRATION_ERROR  2
+#define WARMUP_OFF              0
+#define WARMUP_STEADY           1
 
 // Function prototypes
 char* trim_whitespace(char* str);
+int find_experiment_root(char* root);
 void load_config(const char* filename);
+void free_config();
+void config_report_unused();
+struct config_entry* config_find(const char* key);
+int64_t config_entry_int64(struct config_entry* entry);
+double config_entry_double(struct config_entry* entry);
+uint64_t config_entry_size(struct config_entry* entry);
+int config_entry_bool(struct config_entry* entry);
 char* get_config_string(const char* key);
 int get_config_int(const char* key);
+int64_t get_config_int64(const char* key, int64_t default_value, int64_t min, int64_t max);
+uint64_t get_config_size(const char* key, uint64_t default_value);
 int get_config_bool(const char* key);
+double get_config_double(const char* key);
+int get_config_choice(const char* key, const char* const* choices, int default_index);
+char** get_config_list(const char* key, int* count);
+void free_config_list(char** list, int count);
+int parse_cpu_list(const char* list, int* cpus, int max_cpus);
+int read_cache_sizes(int cpu, size_t* sizes, int max_sizes);
+int isolate_process();
+int build_work_sizes(size_t** sizes);
 FILE* create_data_output_file(const char* filename);
     
-// A simple structure to hold key-value pairs
-typedef struct {
-    char key[256];
-    char value[256];
-} config_entry;
+// Configuration store. config.ini is loaded into an open-addressing hash table sized for
+// the file and indexed both by "section.key" and by the bare key (the first section wins).
+// Typed values are parsed on first use and cached in the entry, so code that reads a key
+// repeatedly can keep the config_entry returned by config_find() instead of looking it up.
+#define CONFIG_PARSED_INT64  0x1
+#define CONFIG_PARSED_DOUBLE 0x2
+#define CONFIG_PARSED_SIZE   0x4
+
+struct config_entry {
+    char*    section;        // NULL for keys before the first [section] header
+    char*    key;
+    char*    qualified_key;  // "section.key", or NULL without a section
+    char*    value;
+    int      line;           // 0 for keys that only exist in the environment
+    int      from_env;
+    int      used;
+    int      parsed;
+    int64_t  int64_value;
+    double   double_value;
+    uint64_t size_value;
+};
+
+struct config_slot {
+    uint64_t             hash;
+    const char*          name;
+    struct config_entry* entry;
+};
+
+struct config_store {
+    const char*           filename;
+    struct config_entry** entries;
+    int                   entry_count;
+    int                   entry_capacity;
+    struct config_slot*   slots;
+    size_t                slot_count;    // Power of two
+    size_t                slot_used;
+};
+
+struct config_store config_store;
+
+// Timer backend selection. CONFIG_TIMER_CYCLES reads the CPU cycle counter directly
+// (serialized rdtsc/rdtscp on x86, cntvct_el0 on aarch64), otherwise clock_gettime is used.
+#if defined(CONFIG_TIMER_CYCLES) && (defined(__x86_64__) || defined(__i386__))
+#define TIMER_BACKEND_TSC
+#include <x86intrin.h>
+#include <cpuid.h>
+#elif defined(CONFIG_TIMER_CYCLES) && defined(__aarch64__)
+#define TIMER_BACKEND_CNTVCT
+#endif
 
-// Assuming a small-medium number of configurations
-config_entry config[256];
-int config_size = 0;
+#define TIMER_CALIBRATION_NS    50000000L   // Spin time used to calibrate ticks against CLOCK_MONOTONIC
+#define TIMER_OVERHEAD_SAMPLES  10000       // Back-to-back reads used to measure timer overhead
 
-// Structure to hold start and end times for a benchmark timer
+// Structure to hold start and end times for a benchmark timer.
+// Values are raw backend ticks, use get_elapsed_ns() to convert them.
 struct timer {
-    struct timespec start;
-    struct timespec end;
+    uint64_t start;
+    uint64_t end;
 };
 
+// Timer calibration results, filled in by timer_init()
+static const char* timer_backend_name = "clock_gettime";
+static double      timer_ns_per_tick = 1.0;
+static uint64_t    timer_overhead_ticks = 0;
+
+static inline __attribute__((always_inline)) uint64_t timespec_to_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000L + ts->tv_nsec;
+}
+
+// Reads the timer at the start of a measured region. Earlier instructions
+// must retire before the read and later ones may not start before it.
+static inline __attribute__((always_inline)) uint64_t timer_read_start() {
+#if defined(TIMER_BACKEND_TSC)
+    _mm_lfence();
+    uint64_t ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+#elif defined(TIMER_BACKEND_CNTVCT)
+    uint64_t ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb" : "=r"(ticks) :: "memory");
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_to_ns(&ts);
+#endif
+}
+
+// Reads the timer at the end of a measured region. rdtscp waits for the
+// measured work to complete, the trailing lfence keeps later work out.
+static inline __attribute__((always_inline)) uint64_t timer_read_stop() {
+#if defined(TIMER_BACKEND_TSC)
+    unsigned int aux;
+    uint64_t ticks = __rdtscp(&aux);
+    _mm_lfence();
+    return ticks;
+#elif defined(TIMER_BACKEND_CNTVCT)
+    uint64_t ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb" : "=r"(ticks) :: "memory");
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_to_ns(&ts);
+#endif
+}
+
 static inline __attribute__((always_inline)) void timer_start(struct timer *timer) {
-    clock_gettime(CLOCK_MONOTONIC, &timer->start);
+    timer->start = timer_read_start();
 }
 
 static inline __attribute__((always_inline)) void timer_stop(struct timer *timer) {
-    clock_gettime(CLOCK_MONOTONIC, &timer->end);
+    timer->end = timer_read_stop();
+}
+
+// Calculate elapsed time in nanoseconds, excluding the measured timer overhead
+uint64_t get_elapsed_ns(struct timer *timer) {
+    uint64_t ticks = timer->end - timer->start;
+    ticks = (ticks > timer_overhead_ticks) ? ticks - timer_overhead_ticks : 0;
+    return (uint64_t)(ticks * timer_ns_per_tick + 0.5);
+}
+
+// Calibrates the tick frequency of the timer backend and measures the cost of an
+// empty timer_start/timer_stop pair, which get_elapsed_ns() subtracts from every sample.
+void timer_init() {
+#if defined(TIMER_BACKEND_TSC)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && !(edx & (1 << 8))) {
+        fprintf(stderr, "Warning: TSC is not invariant, cycle timings will drift with CPU frequency.\n");
+    }
+
+    struct timespec ts_start, ts_end;
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
+    uint64_t tsc_start = timer_read_start();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &ts_end);
+    } while (timespec_to_ns(&ts_end) - timespec_to_ns(&ts_start) < TIMER_CALIBRATION_NS);
+    uint64_t tsc_end = timer_read_stop();
+
+    timer_backend_name = "tsc";
+    timer_ns_per_tick = (double)(timespec_to_ns(&ts_end) - timespec_to_ns(&ts_start)) / (tsc_end - tsc_start);
+#elif defined(TIMER_BACKEND_CNTVCT)
+    uint64_t frequency;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+    timer_backend_name = "cntvct";
+    timer_ns_per_tick = 1e9 / frequency;
+#endif
+
+    // The minimum is used so that noise never causes real work to be subtracted
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < TIMER_OVERHEAD_SAMPLES; ++i) {
+        struct timer timer;
+        timer_start(&timer);
+        timer_stop(&timer);
+        if (timer.end - timer.start < overhead) {
+            overhead = timer.end - timer.start;
+        }
+    }
+    timer_overhead_ticks = overhead;
+
+    printf("Timer backend       : %s (%.4f ns/tick, overhead %lu ticks)\n",
+           timer_backend_name, timer_ns_per_tick, timer_overhead_ticks);
+}
+
+// Compiler barriers for benchmark code. DO_NOT_OPTIMIZE(value) makes the compiler produce
+// value even if nothing uses it, CLOBBER_MEMORY() makes it assume that all memory was read
+// and written, so stores are not dropped or merged and loads are not hoisted across it.
+#define DO_NOT_OPTIMIZE(value)  __asm__ __volatile__("" : : "r,m"(value) : "memory")
+#define CLOBBER_MEMORY()        __asm__ __volatile__("" : : : "memory")
+
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+// Runs LATENCY_BATCH_SIZE copies of body without loop overhead between them
+#define LATENCY_BATCH(body)                                     \
+    do {                                                        \
+        _Pragma("GCC unroll 65534")                             \
+        for (int batch_call = 0; batch_call < LATENCY_BATCH_SIZE; ++batch_call) { \
+            body;                                               \
+            CLOBBER_MEMORY();                                   \
+        }                                                       \
+    } while (0)
+
+#define LATENCY_BASELINE_SAMPLES 10000
+
+// Cost of timing a batch of no-op calls beyond the timer overhead, in picoseconds
+static uint64_t latency_baseline_ps = 0;
+
+static inline __attribute__((always_inline)) uint64_t get_elapsed_ps(struct timer *timer) {
+    uint64_t ticks = timer->end - timer->start;
+    ticks = (ticks > timer_overhead_ticks) ? ticks - timer_overhead_ticks : 0;
+    return (uint64_t)(ticks * timer_ns_per_tick * 1000.0 + 0.5);
+}
+
+#endif
+
+// The value recorded for a latency sample: nanoseconds, or picoseconds per call when batched
+static inline __attribute__((always_inline)) uint64_t latency_value(struct timer *timer) {
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+    uint64_t elapsed = get_elapsed_ps(timer);
+    return (elapsed > latency_baseline_ps ? elapsed - latency_baseline_ps : 0) / LATENCY_BATCH_SIZE;
+#else
+    return get_elapsed_ns(timer);
+#endif
+}
+
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+#define LATENCY_UNIT_SUFFIX             "_ps"
+#define HISTOGRAM_MAGIC                 "APXHISTP"          // Values are picoseconds
+#else
+#define LATENCY_UNIT_SUFFIX             ""
+#define HISTOGRAM_MAGIC                 "APXHIST1"          // Values are nanoseconds
+#endif
+#define HISTOGRAM_HIGHEST_TRACKABLE_NS  3600000000000ULL    // Latencies above one hour are clamped
+
+// Log-linear latency histogram in the style of HdrHistogram. Values are grouped into
+// power-of-two buckets, each split into linear sub-buckets, so every recorded value
+// keeps the configured number of significant decimal digits with a fixed memory footprint.
+struct histogram {
+    int       significant_digits;
+    int       sub_bucket_half_count_magnitude;
+    int       sub_bucket_half_count;
+    uint64_t  sub_bucket_mask;
+    int       bucket_count;
+    int       counts_len;
+    uint64_t  total_count;
+    uint64_t  total_sum;
+    uint64_t  min;
+    uint64_t  max;
+    uint64_t* counts;
+};
+
+// On-disk header preceding the non-zero buckets of each histogram in the binary dump
+struct histogram_record_header {
+    uint32_t threads;
+    uint32_t thread_id;
+    uint64_t work_size;
+    uint64_t total_count;
+    uint64_t min;
+    uint64_t max;
+    uint32_t significant_digits;
+    uint32_t sub_bucket_half_count_magnitude;
+    uint32_t bucket_count;
+    uint32_t nonzero_count;
+};
+
+void histogram_reset(struct histogram *histogram) {
+    memset(histogram->counts, 0, sizeof(uint64_t) * histogram->counts_len);
+    histogram->total_count = 0;
+    histogram->total_sum = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+}
+
+void histogram_init(struct histogram *histogram, int significant_digits) {
+    uint64_t largest_single_unit_value = 2;
+    for (int i = 0; i < significant_digits; ++i) {
+        largest_single_unit_value *= 10;
+    }
+
+    int sub_bucket_count_magnitude = 0;
+    while ((1ULL << sub_bucket_count_magnitude) < largest_single_unit_value) {
+        sub_bucket_count_magnitude++;
+    }
+
+    histogram->significant_digits = significant_digits;
+    histogram->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    histogram->sub_bucket_half_count = 1 << histogram->sub_bucket_half_count_magnitude;
+    histogram->sub_bucket_mask = (1ULL << sub_bucket_count_magnitude) - 1;
+
+    // Each additional bucket doubles the trackable range
+    uint64_t smallest_untrackable_value = 1ULL << sub_bucket_count_magnitude;
+    histogram->bucket_count = 1;
+    while (smallest_untrackable_value <= HISTOGRAM_HIGHEST_TRACKABLE_NS) {
+        smallest_untrackable_value <<= 1;
+        histogram->bucket_count++;
+    }
+
+    histogram->counts_len = (histogram->bucket_count + 1) * histogram->sub_bucket_half_count;
+    histogram->counts = calloc(histogram->counts_len, sizeof(uint64_t));
+    if (!histogram->counts) {
+        fprintf(stderr, "Failed to allocate the latency histogram.\n");
+        exit(1);
+    }
+    histogram_reset(histogram);
+}
+
+void histogram_free(struct histogram *histogram) {
+    free(histogram->counts);
+    histogram->counts = NULL;
+}
+
+static inline __attribute__((always_inline)) int histogram_counts_index(struct histogram *histogram, uint64_t value) {
+    int bucket_index = 64 - __builtin_clzll(value | histogram->sub_bucket_mask) - (histogram->sub_bucket_half_count_magnitude + 1);
+    int sub_bucket_index = (int)(value >> bucket_index);
+    return ((bucket_index + 1) << histogram->sub_bucket_half_count_magnitude) + (sub_bucket_index - histogram->sub_bucket_half_count);
+}
+
+// Highest value that falls into the same sub-bucket as the given counts index
+uint64_t histogram_value_at_index(struct histogram *histogram, int index) {
+    int bucket_index = (index >> histogram->sub_bucket_half_count_magnitude) - 1;
+    int sub_bucket_index = (index & (histogram->sub_bucket_half_count - 1)) + histogram->sub_bucket_half_count;
+    if (bucket_index < 0) {
+        sub_bucket_index -= histogram->sub_bucket_half_count;
+        bucket_index = 0;
+    }
+    return ((uint64_t)sub_bucket_index << bucket_index) + (1ULL << bucket_index) - 1;
+}
+
+static inline __attribute__((always_inline)) void histogram_record(struct histogram *histogram, uint64_t value) {
+    if (value > HISTOGRAM_HIGHEST_TRACKABLE_NS) {
+        value = HISTOGRAM_HIGHEST_TRACKABLE_NS;
+    }
+    histogram->counts[histogram_counts_index(histogram, value)]++;
+    histogram->total_count++;
+    histogram->total_sum += value;
+    if (value < histogram->min) histogram->min = value;
+    if (value > histogram->max) histogram->max = value;
+}
+
+uint64_t histogram_value_at_percentile(struct histogram *histogram, double percentile) {
+    uint64_t count_at_percentile = (uint64_t)(percentile / 100.0 * histogram->total_count + 0.5);
+    if (count_at_percentile < 1) {
+        count_at_percentile = 1;
+    }
+
+    uint64_t running_count = 0;
+    for (int i = 0; i < histogram->counts_len; ++i) {
+        running_count += histogram->counts[i];
+        if (running_count >= count_at_percentile) {
+            uint64_t value = histogram_value_at_index(histogram, i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void histogram_write_summary(struct histogram *histogram, FILE* file, size_t work_size, int threads, int thread_id) {
+    if (histogram->total_count == 0) {
+        return;
+    }
+
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        fprintf(file, "%i,%i,", threads, thread_id);
+    }
+    fprintf(file, "%zu,%lu,%lu,%.2f,%lu,%lu,%lu,%lu,%lu,%lu\n", work_size,
+            histogram->total_count, histogram->min,
+            (double)histogram->total_sum / histogram->total_count,
+            histogram_value_at_percentile(histogram, 50.0),
+            histogram_value_at_percentile(histogram, 90.0),
+            histogram_value_at_percentile(histogram, 99.0),
+            histogram_value_at_percentile(histogram, 99.9),
+            histogram_value_at_percentile(histogram, 99.99),
+            histogram->max);
+}
+
+// Appends the histogram as a header followed by the indices and counts of its non-zero buckets
+void histogram_write_binary(struct histogram *histogram, FILE* file, size_t work_size, int threads, int thread_id) {
+    struct histogram_record_header header = {
+        .threads = (uint32_t)threads,
+        .thread_id = (uint32_t)thread_id,
+        .work_size = (uint64_t)work_size,
+        .total_count = histogram->total_count,
+        .min = histogram->total_count ? histogram->min : 0,
+        .max = histogram->max,
+        .significant_digits = (uint32_t)histogram->significant_digits,
+        .sub_bucket_half_count_magnitude = (uint32_t)histogram->sub_bucket_half_count_magnitude,
+        .bucket_count = (uint32_t)histogram->bucket_count,
+        .nonzero_count = 0,
+    };
+
+    for (int i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i]) header.nonzero_count++;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (int i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i]) {
+            uint32_t index = (uint32_t)i;
+            fwrite(&index, sizeof(index), 1, file);
+        }
+    }
+    for (int i = 0; i < histogram->counts_len; ++i) {
+        if (histogram->counts[i]) {
+            fwrite(&histogram->counts[i], sizeof(uint64_t), 1, file);
+        }
+    }
+}
+
+#if defined(CONFIG_MEASURE_PERF) || defined(CONFIG_MEASURE_POWER)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static long perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+#endif
+
+#ifdef CONFIG_MEASURE_PERF
+
+enum perf_counter_id {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_LLC_LOADS,
+    PERF_COUNTER_COUNT
+};
+
+static const struct {
+    const char* name;
+    uint32_t    type;
+    uint64_t    config;
+} perf_counter_events[PERF_COUNTER_COUNT] = {
+    [PERF_CYCLES]        = { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_INSTRUCTIONS]  = { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [PERF_CACHE_MISSES]  = { "cache_misses",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PERF_BRANCH_MISSES] = { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    [PERF_LLC_LOADS]     = { "llc_loads",     PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                                                                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                                  (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16) },
+};
+
+// Hardware counters of one thread, opened as a single group so that all of them
+// are scheduled together and can be read back with one read() call. Counters the
+// CPU does not support are left out of the group and reported as empty.
+struct perf_counters {
+    int      leader_fd;
+    int      fds[PERF_COUNTER_COUNT];
+    int      slots[PERF_COUNTER_COUNT];
+    int      group_size;
+    int64_t  values[PERF_COUNTER_COUNT];
+};
+
+// Opens the counter group for the calling thread. Returns 0 if no hardware counters
+// are available, in which case only the software clock is reported.
+int perf_counters_open(struct perf_counters *counters) {
+    counters->leader_fd = -1;
+    counters->group_size = 0;
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_counter_events[i].type;
+        attr.config = perf_counter_events[i].config;
+        attr.disabled = (counters->leader_fd == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counters->fds[i] = (int)perf_event_open(&attr, 0, -1, counters->leader_fd, 0);
+        counters->slots[i] = -1;
+        counters->values[i] = -1;
+
+        if (counters->fds[i] != -1) {
+            if (counters->leader_fd == -1) {
+                counters->leader_fd = counters->fds[i];
+            }
+            counters->slots[i] = counters->group_size++;
+        }
+    }
+
+    return counters->leader_fd != -1;
+}
+
+void perf_counters_close(struct perf_counters *counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->fds[i] != -1) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+    counters->leader_fd = -1;
+}
+
+static inline __attribute__((always_inline)) void perf_counters_start(struct perf_counters *counters) {
+    if (counters->leader_fd != -1) {
+        ioctl(counters->leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counters->leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+// Stops the group and reads every counter at once, scaling the values up
+// if the kernel had to multiplex the group with other events
+static inline __attribute__((always_inline)) void perf_counters_stop(struct perf_counters *counters) {
+    if (counters->leader_fd == -1) {
+        return;
+    }
+    ioctl(counters->leader_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    uint64_t buffer[3 + PERF_COUNTER_COUNT];
+    if (read(counters->leader_fd, buffer, sizeof(buffer)) < (ssize_t)(sizeof(uint64_t) * (3 + counters->group_size))) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) counters->values[i] = -1;
+        return;
+    }
+
+    uint64_t time_enabled = buffer[1];
+    uint64_t time_running = buffer[2];
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->slots[i] == -1) {
+            continue;
+        }
+        double value = (double)buffer[3 + counters->slots[i]];
+        if (time_running > 0 && time_running < time_enabled) {
+            value *= (double)time_enabled / time_running;
+        }
+        counters->values[i] = (int64_t)value;
+    }
+}
+
+// Appends the counter deltas of one measured loop along with IPC and misses per kilo-instruction
+void perf_counters_write(struct perf_counters *counters, FILE* file, size_t work_size, int threads, int thread_id, uint64_t iterations, uint64_t elapsed_ns) {
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        fprintf(file, "%i,%i,", threads, thread_id);
+    }
+    fprintf(file, "%zu,%lu,%lu", work_size, iterations, elapsed_ns);
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->values[i] >= 0) {
+            fprintf(file, ",%ld", counters->values[i]);
+        } else {
+            fprintf(file, ",");
+        }
+    }
+
+    int64_t cycles = counters->values[PERF_CYCLES];
+    int64_t instructions = counters->values[PERF_INSTRUCTIONS];
+    if (cycles > 0 && instructions >= 0) {
+        fprintf(file, ",%.4f", (double)instructions / cycles);
+    } else {
+        fprintf(file, ",");
+    }
+
+    int64_t misses[] = { counters->values[PERF_CACHE_MISSES], counters->values[PERF_BRANCH_MISSES] };
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); ++i) {
+        if (instructions > 0 && misses[i] >= 0) {
+            fprintf(file, ",%.4f", misses[i] * 1000.0 / instructions);
+        } else {
+            fprintf(file, ",");
+        }
+    }
+    fprintf(file, "\n");
+}
+#endif
+
+#ifdef CONFIG_MEASURE_POWER
+#include <dirent.h>
+
+#define ENERGY_MAX_DOMAINS          16
+#define ENERGY_SIMULATED_RANGE_UJ   1000000000ULL   // Wraps every 1000 J so that overflow handling gets exercised
+#define POWERCAP_PATH               "/sys/class/powercap"
+#define POWER_PMU_PATH              "/sys/bus/event_source/devices/power"
+
+enum energy_source {
+    ENERGY_SOURCE_NONE,
+    ENERGY_SOURCE_POWERCAP,
+    ENERGY_SOURCE_PERF,
+    ENERGY_SOURCE_SIMULATED,
+};
+
+// One RAPL energy counter (package, core, dram, psys...) and its readings around a measured loop
+struct energy_domain {
+    char     name[64];
+    int      fd;
+    double   joules_per_unit;
+    uint64_t max_range;         // Counter wraps to zero past this value, 0 if it never wraps
+    uint64_t start;
+    uint64_t end;
+};
+
+struct energy_meter {
+    enum energy_source   source;
+    const char*          source_name;
+    double               simulated_watts;
+    int                  domain_count;
+    struct energy_domain domains[ENERGY_MAX_DOMAINS];
+};
+
+static int read_sysfs_string(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    int ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    if (ok) {
+        buffer[strcspn(buffer, "\n")] = '\0';
+    }
+    return ok;
+}
+
+// Uses the powercap RAPL zones, e.g. intel-rapl:0 (package-0) and intel-rapl:0:0 (core)
+int energy_meter_open_powercap(struct energy_meter *meter) {
+    DIR* dir = opendir(POWERCAP_PATH);
+    if (!dir) {
+        return 0;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && meter->domain_count < ENERGY_MAX_DOMAINS) {
+        if (strncmp(entry->d_name, "intel-rapl:", strlen("intel-rapl:")) != 0) {
+            continue;
+        }
+
+        char path[PATH_MAX];
+        char value[64];
+        struct energy_domain* domain = &meter->domains[meter->domain_count];
+
+        snprintf(path, sizeof(path), "%s/%s/energy_uj", POWERCAP_PATH, entry->d_name);
+        domain->fd = open(path, O_RDONLY);
+        if (domain->fd == -1) {
+            continue; // energy_uj is usually only readable by root
+        }
+
+        snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", POWERCAP_PATH, entry->d_name);
+        domain->max_range = read_sysfs_string(path, value, sizeof(value)) ? strtoull(value, NULL, 10) : 0;
+        domain->joules_per_unit = 1e-6;
+
+        snprintf(path, sizeof(path), "%s/%s/name", POWERCAP_PATH, entry->d_name);
+        if (!read_sysfs_string(path, value, sizeof(value))) {
+            strcpy(value, "unknown");
+        }
+        snprintf(domain->name, sizeof(domain->name), "%.20s(%.30s)", entry->d_name, value);
+        meter->domain_count++;
+    }
+
+    closedir(dir);
+    return meter->domain_count > 0;
+}
+
+// Uses the power/energy-* events of the perf RAPL PMU, opened on one CPU of every package
+int energy_meter_open_perf(struct energy_meter *meter) {
+    char value[256];
+    if (!read_sysfs_string(POWER_PMU_PATH "/type", value, sizeof(value))) {
+        return 0;
+    }
+    uint32_t type = (uint32_t)strtoul(value, NULL, 10);
+
+    int cpus[CPU_SETSIZE];
+    int cpu_count = read_sysfs_string(POWER_PMU_PATH "/cpumask", value, sizeof(value)) ? parse_cpu_list(value, cpus, CPU_SETSIZE) : 0;
+    if (cpu_count == 0) {
+        cpus[cpu_count++] = 0;
+    }
+
+    DIR* dir = opendir(POWER_PMU_PATH "/events");
+    if (!dir) {
+        return 0;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "energy-", strlen("energy-")) != 0 || strchr(entry->d_name, '.')) {
+            continue;
+        }
+
+        char path[PATH_MAX];
+        unsigned long config = 0;
+        snprintf(path, sizeof(path), "%s/events/%s", POWER_PMU_PATH, entry->d_name);
+        if (!read_sysfs_string(path, value, sizeof(value)) || sscanf(value, "event=%lx", &config) != 1) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/events/%s.scale", POWER_PMU_PATH, entry->d_name);
+        double scale = read_sysfs_string(path, value, sizeof(value)) ? strtod(value, NULL) : 0.0;
+
+        for (int i = 0; i < cpu_count && meter->domain_count < ENERGY_MAX_DOMAINS; ++i) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+
+            struct energy_domain* domain = &meter->domains[meter->domain_count];
+            domain->fd = (int)perf_event_open(&attr, -1, cpus[i], -1, 0);
+            if (domain->fd == -1) {
+                continue; // System-wide events need CAP_PERFMON or a low perf_event_paranoid
+            }
+            domain->joules_per_unit = scale;
+            domain->max_range = 0;
+            snprintf(domain->name, sizeof(domain->name), "%.40s@cpu%d", entry->d_name, cpus[i]);
+            meter->domain_count++;
+        }
+    }
+
+    closedir(dir);
+    return meter->domain_count > 0;
+}
+
+// Opens the configured energy source. "auto" tries powercap first and the perf PMU second.
+void energy_meter_open(struct energy_meter *meter, const char* source, double simulated_watts) {
+    memset(meter, 0, sizeof(*meter));
+    meter->source = ENERGY_SOURCE_NONE;
+    meter->source_name = "none";
+
+    int is_auto = (source == NULL || strlen(source) == 0 || strcmp(source, "auto") == 0);
+
+    if (source && strcmp(source, "simulated") == 0) {
+        meter->source = ENERGY_SOURCE_SIMULATED;
+        meter->source_name = "simulated";
+        meter->simulated_watts = simulated_watts;
+        meter->domain_count = 1;
+        meter->domains[0].fd = -1;
+        meter->domains[0].joules_per_unit = 1e-6;
+        meter->domains[0].max_range = ENERGY_SIMULATED_RANGE_UJ;
+        snprintf(meter->domains[0].name, sizeof(meter->domains[0].name), "simulated");
+    } else if ((is_auto || strcmp(source, "powercap") == 0) && energy_meter_open_powercap(meter)) {
+        meter->source = ENERGY_SOURCE_POWERCAP;
+        meter->source_name = "powercap";
+    } else if ((is_auto || strcmp(source, "perf") == 0) && energy_meter_open_perf(meter)) {
+        meter->source = ENERGY_SOURCE_PERF;
+        meter->source_name = "perf";
+    } else {
+        fprintf(stderr, "Warning: no readable RAPL energy counters for source '%s', energy is not recorded.\n", source ? source : "auto");
+    }
+}
+
+void energy_meter_close(struct energy_meter *meter) {
+    for (int i = 0; i < meter->domain_count; ++i) {
+        if (meter->domains[i].fd != -1) {
+            close(meter->domains[i].fd);
+        }
+    }
+    meter->domain_count = 0;
+}
+
+static uint64_t energy_domain_read(struct energy_meter *meter, struct energy_domain *domain) {
+    uint64_t value = 0;
+
+    if (meter->source == ENERGY_SOURCE_POWERCAP) {
+        char buffer[32];
+        ssize_t length = pread(domain->fd, buffer, sizeof(buffer) - 1, 0);
+        if (length > 0) {
+            buffer[length] = '\0';
+            value = strtoull(buffer, NULL, 10);
+        }
+    } else if (meter->source == ENERGY_SOURCE_PERF) {
+        if (read(domain->fd, &value, sizeof(value)) != sizeof(value)) {
+            value = 0;
+        }
+    } else if (meter->source == ENERGY_SOURCE_SIMULATED) {
+        // A constant power draw integrated over CLOCK_MONOTONIC, in microjoules
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        value = (uint64_t)(timespec_to_ns(&ts) * meter->simulated_watts / 1e3) % (domain->max_range + 1);
+    }
+
+    return value;
+}
+
+void energy_meter_start(struct energy_meter *meter) {
+    for (int i = 0; i < meter->domain_count; ++i) {
+        meter->domains[i].start = energy_domain_read(meter, &meter->domains[i]);
+    }
+}
+
+void energy_meter_stop(struct energy_meter *meter) {
+    for (int i = 0; i < meter->domain_count; ++i) {
+        meter->domains[i].end = energy_domain_read(meter, &meter->domains[i]);
+    }
+}
+
+// Energy consumed between start and stop, assuming the counter wrapped at most once
+double energy_domain_joules(struct energy_domain *domain) {
+    uint64_t delta;
+    if (domain->end >= domain->start) {
+        delta = domain->end - domain->start;
+    } else {
+        // max_range is the largest value the counter reaches, the step past it reads zero
+        delta = domain->end + (domain->max_range - domain->start) + 1;
+    }
+    return delta * domain->joules_per_unit;
+}
+
+void energy_meter_write(struct energy_meter *meter, FILE* file, size_t work_size, int threads, uint64_t iterations, uint64_t elapsed_ns) {
+    for (int i = 0; i < meter->domain_count; ++i) {
+        double joules = energy_domain_joules(&meter->domains[i]);
+        if (EXPERIMENT_THREAD_MAX > 0) {
+            fprintf(file, "%i,", threads);
+        }
+        fprintf(file, "%zu,%lu,%s,%s,%lu,%.6f,%.4f,%.4f\n", work_size, iterations,
+                meter->source_name, meter->domains[i].name, elapsed_ns, joules,
+                elapsed_ns ? joules / (elapsed_ns / 1e9) : 0.0,
+                iterations ? joules * 1e9 / iterations : 0.0);
+    }
+}
+#endif
+
+#define COLUMNAR_MAGIC          "APXCOL01"
+#define COLUMNAR_MAX_COLUMNS    8
+#define COLUMNAR_ALIGNMENT      64      // Column data starts on a cache-line boundary
+#define COLUMNAR_CHUNK_SIZE     4096    // Samples converted per write when appending timers
+
+enum columnar_type {
+    COLUMNAR_U32 = 1,
+    COLUMNAR_U64 = 2,
+    COLUMNAR_F64 = 3,
+};
+
+enum columnar_encoding {
+    COLUMNAR_PLAIN = 0,     // One value per row
+    COLUMNAR_RLE = 1,       // (uint64 value, uint64 count) pairs
+};
+
+// On-disk file header, followed by column_count descriptors and then the column data
+struct columnar_file_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t column_count;
+    uint64_t row_count;
+    uint8_t  reserved[40];
+};
+
+struct columnar_column_header {
+    char     name[32];
+    uint32_t type;
+    uint32_t encoding;
+    uint64_t offset;        // Byte offset of the column data from the start of the file
+    uint64_t length;        // Number of values, or number of runs for RLE columns
+    uint64_t reserved;
+};
+
+// Binary columnar result file. Columns are streamed into temporary spill files while the
+// experiment runs and laid out contiguously behind a fixed header when the file is closed,
+// so a reader can memory-map every column as a plain typed array.
+struct columnar_file {
+    FILE*                         file;
+    int                           column_count;
+    struct columnar_column_header headers[COLUMNAR_MAX_COLUMNS];
+    FILE*                         spills[COLUMNAR_MAX_COLUMNS];
+    uint64_t                      rows[COLUMNAR_MAX_COLUMNS];
+    uint64_t                      run_value[COLUMNAR_MAX_COLUMNS];
+    uint64_t                      run_count[COLUMNAR_MAX_COLUMNS];
+};
+
+struct columnar_file* columnar_create(const char* filename) {
+    FILE* file = create_data_output_file(filename);
+    if (!file) {
+        return NULL;
+    }
+
+    struct columnar_file* columnar = calloc(1, sizeof(struct columnar_file));
+    columnar->file = file;
+    return columnar;
+}
+
+int columnar_add_column(struct columnar_file* columnar, const char* name, enum columnar_type type, enum columnar_encoding encoding) {
+    if (columnar->column_count == COLUMNAR_MAX_COLUMNS) {
+        fprintf(stderr, "Too many columns in binary result file.\n");
+        exit(1);
+    }
+
+    int column = columnar->column_count++;
+    struct columnar_column_header* header = &columnar->headers[column];
+    snprintf(header->name, sizeof(header->name), "%s", name);
+    header->type = type;
+    header->encoding = encoding;
+
+    columnar->spills[column] = tmpfile();
+    if (!columnar->spills[column]) {
+        perror("tmpfile");
+        exit(1);
+    }
+    return column;
+}
+
+static void columnar_flush_run(struct columnar_file* columnar, int column) {
+    if (columnar->run_count[column] > 0) {
+        uint64_t run[2] = { columnar->run_value[column], columnar->run_count[column] };
+        fwrite(run, sizeof(run), 1, columnar->spills[column]);
+        columnar->headers[column].length++;
+        columnar->run_count[column] = 0;
+    }
+}
+
+// Appends count repetitions of value to a run-length encoded column
+void columnar_append_run(struct columnar_file* columnar, int column, uint64_t value, uint64_t count) {
+    if (columnar->run_count[column] > 0 && columnar->run_value[column] != value) {
+        columnar_flush_run(columnar, column);
+    }
+    columnar->run_value[column] = value;
+    columnar->run_count[column] += count;
+    columnar->rows[column] += count;
+}
+
+// Appends plain values, which must already be in the column's type
+void columnar_append(struct columnar_file* columnar, int column, const void* values, size_t count) {
+    size_t size = (columnar->headers[column].type == COLUMNAR_U32) ? sizeof(uint32_t) : sizeof(uint64_t);
+    fwrite(values, size, count, columnar->spills[column]);
+    columnar->headers[column].length += count;
+    columnar->rows[column] += count;
 }
 
-// Calculate elapsed time in nanoseconds
-uint64_t get_elapsed_ns(struct timer *timer) {
-    uint64_t start_ns = (uint64_t)timer->start.tv_sec * 1000000000L + timer->start.tv_nsec;
-    uint64_t end_ns = (uint64_t)timer->end.tv_sec * 1000000000L + timer->end.tv_nsec;
-    return end_ns - start_ns;
-}
+// Appends the latency_value() of an array of timers to a plain uint64 column
+void columnar_append_timers(struct columnar_file* columnar, int column, struct timer* timers, size_t count) {
+    uint64_t chunk[COLUMNAR_CHUNK_SIZE];
+    for (size_t i = 0; i < count; i += COLUMNAR_CHUNK_SIZE) {
+        size_t chunk_length = (count - i < COLUMNAR_CHUNK_SIZE) ? count - i : COLUMNAR_CHUNK_SIZE;
+        for (size_t j = 0; j < chunk_length; ++j) {
+            chunk[j] = latency_value(&timers[i + j]);
+        }
+        columnar_append(columnar, column, chunk, chunk_length);
+    }
+}
+
+void columnar_close(struct columnar_file* columnar) {
+    if (!columnar) {
+        return;
+    }
+
+    struct columnar_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMNAR_MAGIC, sizeof(header.magic));
+    header.version = 1;
+    header.column_count = (uint32_t)columnar->column_count;
+    header.row_count = columnar->column_count ? columnar->rows[0] : 0;
+
+    // Lay the columns out back to back after the headers
+    uint64_t offset = sizeof(header) + sizeof(struct columnar_column_header) * columnar->column_count;
+    for (int c = 0; c < columnar->column_count; ++c) {
+        if (columnar->headers[c].encoding == COLUMNAR_RLE) {
+            columnar_flush_run(columnar, c);
+        }
+        if (columnar->rows[c] != header.row_count) {
+            fprintf(stderr, "Warning: column '%s' has %lu rows, expected %lu.\n", columnar->headers[c].name, columnar->rows[c], header.row_count);
+        }
+
+        offset = (offset + COLUMNAR_ALIGNMENT - 1) & ~(uint64_t)(COLUMNAR_ALIGNMENT - 1);
+        columnar->headers[c].offset = offset;
+        offset += (uint64_t)ftell(columnar->spills[c]);
+    }
+
+    fwrite(&header, sizeof(header), 1, columnar->file);
+    fwrite(columnar->headers, sizeof(struct columnar_column_header), columnar->column_count, columnar->file);
+
+    static char buffer[1 << 20];
+    for (int c = 0; c < columnar->column_count; ++c) {
+        fseek(columnar->file, (long)columnar->headers[c].offset, SEEK_SET);
+        rewind(columnar->spills[c]);
+        size_t length;
+        while ((length = fread(buffer, 1, sizeof(buffer), columnar->spills[c])) > 0) {
+            fwrite(buffer, 1, length, columnar->file);
+        }
+        fclose(columnar->spills[c]);
+    }
+
+    fclose(columnar->file);
+    free(columnar);
+}
+
+// Workload memory allocator for experiment buffers. workload_alloc maps anonymous memory with
+// the requested page size, NUMA node and alignment, and can fault every page in up front so
+// that neither page faults nor TLB refills of a cold mapping land in the measured loop.
+//   flags      WORKLOAD_PAGES_THP, _2MB or _1GB, optionally combined with WORKLOAD_POPULATE
+//   numa_node  node to bind the pages to with mbind, or WORKLOAD_NODE_ANY for the default policy
+//   alignment  0 for page alignment, otherwise a power of two such as CACHE_LINE_SIZE or 1 GB
+// Explicit huge pages come from the hugetlb pool (/proc/sys/vm/nr_hugepages). When the pool is
+// empty the allocation falls back to transparent huge pages with a warning.
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#define CACHE_LINE_SIZE         64
+
+#define WORKLOAD_PAGES_THP      0x1     // Transparent huge pages, where the kernel can provide them
+#define WORKLOAD_PAGES_2MB      0x2     // Explicit 2 MB huge pages
+#define WORKLOAD_PAGES_1GB      0x4     // Explicit 1 GB huge pages
+#define WORKLOAD_POPULATE       0x8     // Fault every page in before returning
+#define WORKLOAD_NODE_ANY       -1
+
+#define WORKLOAD_HUGE_2MB_SHIFT 21
+#define WORKLOAD_HUGE_1GB_SHIFT 30
+
+// Mappings handed out by workload_alloc, so that workload_free only needs the address
+struct workload_mapping {
+    void*                    address;
+    size_t                   length;
+    struct workload_mapping* next;
+};
+
+static struct workload_mapping* workload_mappings = NULL;
+static pthread_mutex_t          workload_mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* workload_map(size_t length, int huge_shift) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (huge_shift) {
+        flags |= MAP_HUGETLB | (huge_shift << MAP_HUGE_SHIFT);
+    }
+    void* address = mmap(NULL, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return address == MAP_FAILED ? NULL : address;
+}
+
+void* workload_alloc(size_t size, size_t alignment, int flags, int numa_node) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    int huge_shift = (flags & WORKLOAD_PAGES_1GB) ? WORKLOAD_HUGE_1GB_SHIFT :
+                     (flags & WORKLOAD_PAGES_2MB) ? WORKLOAD_HUGE_2MB_SHIFT : 0;
+    if (size == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    char* address = NULL;
+    size_t length = 0;
+    if (huge_shift) {
+        // Huge page mappings are aligned to their page size, which covers any smaller alignment
+        size_t huge_page_size = (size_t)1 << huge_shift;
+        size_t padding = alignment > huge_page_size ? alignment : 0;
+        length = (size + padding + huge_page_size - 1) & ~(huge_page_size - 1);
+        address = workload_map(length, huge_shift);
+        if (!address) {
+            static int warned = 0;
+            if (!warned) {
+                fprintf(stderr, "Warning: no %s huge pages available (%s), using transparent huge pages.\n",
+                        huge_shift == WORKLOAD_HUGE_1GB_SHIFT ? "1 GB" : "2 MB", strerror(errno));
+                warned = 1;
+            }
+            flags |= WORKLOAD_PAGES_THP;
+            huge_shift = 0;
+        } else {
+            page_size = huge_page_size;
+        }
+    }
+
+    // Transparent huge pages are only used for 2 MB aligned ranges
+    if ((flags & WORKLOAD_PAGES_THP) && alignment < ((size_t)1 << WORKLOAD_HUGE_2MB_SHIFT)) {
+        alignment = (size_t)1 << WORKLOAD_HUGE_2MB_SHIFT;
+    }
+
+    if (!address) {
+        size_t padding = alignment > page_size ? alignment : 0;
+        length = (size + padding + page_size - 1) & ~(page_size - 1);
+        address = workload_map(length, 0);
+        if (!address) {
+            return NULL;
+        }
+    }
+
+    // Over-allocate for alignment beyond the page size and return the unused ends
+    if (alignment > page_size) {
+        char* aligned = (char*)(((uintptr_t)address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        size_t aligned_length = (size + page_size - 1) & ~(page_size - 1);
+        if (aligned > address) {
+            munmap(address, aligned - address);
+        }
+        if (address + length > aligned + aligned_length) {
+            munmap(aligned + aligned_length, (address + length) - (aligned + aligned_length));
+        }
+        address = aligned;
+        length = aligned_length;
+    }
+
+    if ((flags & WORKLOAD_PAGES_THP) && madvise(address, length, MADV_HUGEPAGE) != 0) {
+        fprintf(stderr, "Warning: transparent huge pages unavailable: %s\n", strerror(errno));
+    }
+
+    if (numa_node != WORKLOAD_NODE_ANY) {
+        unsigned long node_mask[16] = { 0 };
+        if (numa_node < 0 || numa_node >= (int)(sizeof(node_mask) * 8)) {
+            munmap(address, length);
+            errno = EINVAL;
+            return NULL;
+        }
+        node_mask[numa_node / (8 * sizeof(unsigned long))] = 1UL << (numa_node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_mbind, address, length, MPOL_BIND, node_mask, sizeof(node_mask) * 8, MPOL_MF_STRICT) != 0) {
+            fprintf(stderr, "Warning: failed to bind memory to NUMA node %d: %s\n", numa_node, strerror(errno));
+        }
+    }
+
+    // Pages are touched after the advice and binding above, so the first touch places them accordingly
+    if (flags & WORKLOAD_POPULATE) {
+        for (size_t offset = 0; offset < length; offset += page_size) {
+            ((volatile char*)address)[offset] = 0;
+        }
+    }
+
+    struct workload_mapping* mapping = malloc(sizeof(struct workload_mapping));
+    if (!mapping) {
+        munmap(address, length);
+        errno = ENOMEM;
+        return NULL;
+    }
+    mapping->address = address;
+    mapping->length = length;
+    pthread_mutex_lock(&workload_mappings_lock);
+    mapping->next = workload_mappings;
+    workload_mappings = mapping;
+    pthread_mutex_unlock(&workload_mappings_lock);
+    return address;
+}
+
+void workload_free(void* address) {
+    if (!address) {
+        return;
+    }
+
+    pthread_mutex_lock(&workload_mappings_lock);
+    struct workload_mapping** link = &workload_mappings;
+    while (*link && (*link)->address != address) {
+        link = &(*link)->next;
+    }
+    struct workload_mapping* mapping = *link;
+    if (mapping) {
+        *link = mapping->next;
+    }
+    pthread_mutex_unlock(&workload_mappings_lock);
+
+    if (!mapping) {
+        fprintf(stderr, "Warning: workload_free called with %p, which workload_alloc did not return.\n", address);
+        return;
+    }
+    munmap(mapping->address, mapping->length);
+    free(mapping);
+}
+
+// State handed to the benchmark hooks, one per worker. The context lives as long as the
+// worker, so user state set up for one work size is still there for the next one.
+struct benchmark_context {
+    size_t             work_size;
+    int                thread_id;
+    int                thread_count;
+    uint64_t           iteration;      // Index of the current call in the warmup, pilot or measured loop
+    uint64_t           rng_state;      // Seeded from experiment_seed, the thread and the work size
+    void*              user;           // Free for the hooks, e.g. a buffer built by setup_work_size
+};
+
+// Next value of the context's splitmix64 generator. Deterministic for a given seed, thread
+// and work size, so every configuration sees the same sequence.
+static inline __attribute__((always_inline)) uint64_t benchmark_random(struct benchmark_context* context) {
+    uint64_t z = (context->rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Tells the core that the caller is spinning on a memory location, which frees execution
+// resources for an SMT sibling and avoids a pipeline flush when the awaited store arrives
+static inline __attribute__((always_inline)) void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield" ::: "memory");
+#else
+    __asm__ volatile("" ::: "memory");
+#endif
+}
+
+// Busy work of about one cycle per iteration that the compiler cannot remove, e.g. as think
+// time between operations on shared data. Unlike cpu_relax its length is similar on all CPUs.
+static inline __attribute__((always_inline)) void benchmark_delay(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+        __asm__ volatile("" ::: "memory");
+    }
+}
+
+// Workload begin: the experiment wizard replaces everything up to "Workload end" with the
+// selected workload template, a blank experiment keeps these empty hooks
+void setup() {
+    // Any experimental prep work or setup goes here
+}
+
+void cleanup() {
+    // Cleanup work goes here
+}
+
+// Runs on every worker before each work size, its time is recorded in setup.csv
+void setup_work_size(struct benchmark_context* context) {
+    // Per-size preparation goes here, e.g. building a structure of context->work_size elements
+    (void)context;
+}
+
+// Runs on every worker after each work size
+void teardown_work_size(struct benchmark_context* context) {
+    // Release what setup_work_size created
+    (void)context;
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    // Benchmark workload
+    (void)context;
+}
+// Workload end
+
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+// Stands in for benchmark_function when measuring the harness cost of a batch
+static inline __attribute__((always_inline)) void latency_baseline_function(struct benchmark_context* context) {
+    (void)context;
+}
+
+// Global, so the iteration stores survive the batch's memory clobbers as they do on a worker
+static struct benchmark_context latency_baseline_context;
+
+// Times the measured loop body with a no-op call, so the baseline covers the iteration stores
+// and batch overhead. Like the timer overhead, the minimum is used.
+void latency_baseline_init() {
+    uint64_t baseline = UINT64_MAX;
+    for (int i = 0; i < LATENCY_BASELINE_SAMPLES; ++i) {
+        struct timer timer;
+        timer_start(&timer);
+        LATENCY_BATCH(latency_baseline_context.iteration = (uint64_t)i * LATENCY_BATCH_SIZE + batch_call;
+                      latency_baseline_function(&latency_baseline_context));
+        timer_stop(&timer);
+        uint64_t elapsed = get_elapsed_ps(&timer);
+        if (elapsed < baseline) {
+            baseline = elapsed;
+        }
+    }
+    latency_baseline_ps = baseline;
+
+    printf("Latency batch       : %d calls per sample, baseline %lu ps, latencies are ps per call\n",
+           LATENCY_BATCH_SIZE, latency_baseline_ps);
+}
+#endif
+
+// Warmup of one worker at one work size, batch times are in nanoseconds
+struct warmup_stats {
+    int                batches;
+    int                converged;
+    uint64_t           iterations;
+    uint64_t           elapsed_ns;
+    uint64_t           first_batch_ns;
+    uint64_t           steady_batch_ns;
+};
+
+// Per-thread benchmark state. Workers are cache-line aligned so that the timers
+// written inside the measured loop never share a line with another thread's data.
+struct worker {
+    pthread_t          thread;
+    int                thread_id;
+    int                thread_count;
+    int                cpu;
+    struct timer       outer_timer;
+    struct timer       latency_sample;
+    struct timer*      runs;
+    uint64_t           pilot_iterations;
+    double             pilot_mean_ns;
+    double             pilot_stddev_ns;
+    struct warmup_stats warmup;
+    struct benchmark_context context;
+    uint64_t           setup_ns;
+    uint64_t           teardown_ns;
+#ifdef CONFIG_MEASURE_LATENCY
+    struct histogram   histogram;
+#endif
+#ifdef CONFIG_MEASURE_PERF
+    struct perf_counters perf;
+#endif
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+// Shared state of the current thread-count step
+static struct worker*       workers = NULL;
+static pthread_barrier_t    worker_barrier;
+static int*                 worker_cpus = NULL;
+static int                  worker_cpu_count = 0;
+static int                  worker_loop_count = 0;     // Iterations of the measured loop at the current work size
+
+
+// Loop-count calibration. Every worker times a short pilot of single calls, then thread 0
+// picks the iteration count that reaches experiment_target_time, or the count at which the
+// 95% confidence interval of the mean call time is within experiment_target_error of the
+// mean (capped by the target time when one is set). experiment_loop_count is the upper bound.
+#define CALIBRATION_PILOT_MIN_NS          1000000ULL      // The pilot takes a tenth of the target time,
+#define CALIBRATION_PILOT_MAX_NS          100000000ULL    // but at least 1 ms and at most 100 ms
+#define CALIBRATION_PILOT_MIN_ITERATIONS  10
+
+static FILE* calibration_log = NULL;
+
+void calibration_pilot(struct worker* worker) {
+    uint64_t budget_ns = (uint64_t)(EXPERIMENT_TARGET_TIME * 1e8);
+    if (budget_ns < CALIBRATION_PILOT_MIN_NS) budget_ns = CALIBRATION_PILOT_MIN_NS;
+    if (budget_ns > CALIBRATION_PILOT_MAX_NS) budget_ns = CALIBRATION_PILOT_MAX_NS;
+
+    // Running mean and variance of the call time (Welford)
+    uint64_t iterations = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    struct timer pilot_timer;
+    struct timer sample;
+
+    timer_start(&pilot_timer);
+    while (iterations < (uint64_t)EXPERIMENT_LOOP_COUNT) {
+        worker->context.iteration = iterations;
+        timer_start(&sample);
+        benchmark_function(&worker->context);
+        timer_stop(&sample);
+
+        double ns = (double)get_elapsed_ns(&sample);
+        iterations++;
+        double delta = ns - mean;
+        mean += delta / iterations;
+        m2 += delta * (ns - mean);
+
+        // Calls shorter than the timer resolution read as zero, so the budget is checked on wall time
+        if (iterations >= CALIBRATION_PILOT_MIN_ITERATIONS && (iterations & 63) == 0) {
+            timer_stop(&pilot_timer);
+            if (get_elapsed_ns(&pilot_timer) >= budget_ns) {
+                break;
+            }
+        }
+    }
+
+    worker->pilot_iterations = iterations;
+    worker->pilot_mean_ns = mean;
+    worker->pilot_stddev_ns = iterations > 1 ? sqrt(m2 / (iterations - 1)) : 0.0;
+}
+
+// Uses the slowest mean and the largest relative spread of all workers, so that every worker meets the target
+int calibration_loop_count(int thread_count) {
+    double mean_ns = 0.0;
+    double cv = 0.0;
+    for (int t = 0; t < thread_count; ++t) {
+        struct worker* worker = &workers[t];
+        if (worker->pilot_mean_ns > mean_ns) mean_ns = worker->pilot_mean_ns;
+        if (worker->pilot_mean_ns > 0 && worker->pilot_stddev_ns / worker->pilot_mean_ns > cv) {
+            cv = worker->pilot_stddev_ns / worker->pilot_mean_ns;
+        }
+    }
+    if (mean_ns < 1.0) {
+        mean_ns = 1.0;
+    }
+
+    double time_count = EXPERIMENT_TARGET_TIME * 1e9 / mean_ns;
+    double count = time_count;
+    if (EXPERIMENT_LOOP_CALIBRATION == LOOP_CALIBRATION_ERROR) {
+        double z = 1.96 * cv / EXPERIMENT_TARGET_ERROR;
+        count = z * z;
+        if (EXPERIMENT_TARGET_TIME > 0 && count > time_count) {
+            count = time_count;
+        }
+    }
+
+    // The pilot times single calls, a batched iteration makes CALLS_PER_ITERATION of them
+    count /= CALLS_PER_ITERATION;
+    if (count < EXPERIMENT_LOOP_MIN_COUNT) count = EXPERIMENT_LOOP_MIN_COUNT;
+    if (count > EXPERIMENT_LOOP_COUNT) count = EXPERIMENT_LOOP_COUNT;
+    return (int)ceil(count);
+}
+
+void calibration_write(FILE* file, size_t work_size, int thread_count, int loop_count) {
+    uint64_t pilot_iterations = 0;
+    double mean_ns = 0.0;
+    double stddev_ns = 0.0;
+    for (int t = 0; t < thread_count; ++t) {
+        pilot_iterations += workers[t].pilot_iterations;
+        if (workers[t].pilot_mean_ns > mean_ns) {
+            mean_ns = workers[t].pilot_mean_ns;
+            stddev_ns = workers[t].pilot_stddev_ns;
+        }
+    }
+
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        fprintf(file, "%i,", thread_count);
+    }
+    fprintf(file, "%zu,%s,%lu,%.2f,%.2f,%d\n", work_size,
+            EXPERIMENT_LOOP_CALIBRATION == LOOP_CALIBRATION_TIME ? "time" : "error",
+            pilot_iterations, mean_ns, stddev_ns, loop_count);
+}
+
+
+// Steady-state warmup. Every worker runs batches of experiment_warmup_batch_size calls at
+// every work size and compares the median batch time of the latest experiment_warmup_window
+// batches with that of the window before. Warmup ends once the medians differ by no more
+// than the median absolute deviation of the earlier window, or by experiment_warmup_tolerance
+// of its median, and is cut off after experiment_warmup_max_batches.
+#define WARMUP_MAX_WINDOW   64
+
+static FILE* warmup_log = NULL;
+
+// Median of count values, which are reordered
+static uint64_t warmup_median(uint64_t* values, int count) {
+    for (int i = 1; i < count; ++i) {
+        uint64_t value = values[i];
+        int j = i - 1;
+        for (; j >= 0 && values[j] > value; --j) {
+            values[j + 1] = values[j];
+        }
+        values[j + 1] = value;
+    }
+    return (count % 2) ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+void warmup_run(struct worker* worker) {
+    struct warmup_stats* stats = &worker->warmup;
+    int window = EXPERIMENT_WARMUP_WINDOW;
+    uint64_t history[2 * WARMUP_MAX_WINDOW];    // Ring of the latest two windows of batch times
+    uint64_t previous[WARMUP_MAX_WINDOW];
+    uint64_t recent[WARMUP_MAX_WINDOW];
+    struct timer batch_timer;
+
+    memset(stats, 0, sizeof(*stats));
+    for (int batch = 0; batch < EXPERIMENT_WARMUP_MAX_BATCHES; ++batch) {
+        timer_start(&batch_timer);
+        for (int i = 0; i < EXPERIMENT_WARMUP_BATCH_SIZE; ++i) {
+            worker->context.iteration = (uint64_t)batch * EXPERIMENT_WARMUP_BATCH_SIZE + i;
+            benchmark_function(&worker->context);
+        }
+        timer_stop(&batch_timer);
+
+        uint64_t batch_ns = get_elapsed_ns(&batch_timer);
+        history[batch % (2 * window)] = batch_ns;
+        if (batch == 0) {
+            stats->first_batch_ns = batch_ns;
+        }
+        stats->batches++;
+        stats->elapsed_ns += batch_ns;
+
+        if (batch + 1 < 2 * window) {
+            continue;
+        }
+
+        for (int i = 0; i < window; ++i) {
+            previous[i] = history[(batch + 1 + i) % (2 * window)];
+            recent[i] = history[(batch + 1 + window + i) % (2 * window)];
+        }
+        uint64_t previous_median = warmup_median(previous, window);
+        uint64_t recent_median = warmup_median(recent, window);
+        for (int i = 0; i < window; ++i) {
+            previous[i] = previous[i] > previous_median ? previous[i] - previous_median : previous_median - previous[i];
+        }
+        uint64_t previous_mad = warmup_median(previous, window);
+
+        uint64_t difference = recent_median > previous_median ? recent_median - previous_median : previous_median - recent_median;
+        if (difference <= previous_mad || difference <= EXPERIMENT_WARMUP_TOLERANCE * previous_median) {
+            stats->converged = 1;
+            stats->steady_batch_ns = recent_median;
+            break;
+        }
+    }
+
+    // Without convergence the latest batches are the best estimate of the steady state
+    if (!stats->converged) {
+        int count = stats->batches < window ? stats->batches : window;
+        for (int i = 0; i < count; ++i) {
+            recent[i] = history[(stats->batches - 1 - i) % (2 * window)];
+        }
+        stats->steady_batch_ns = count ? warmup_median(recent, count) : 0;
+    }
+    stats->iterations = (uint64_t)stats->batches * EXPERIMENT_WARMUP_BATCH_SIZE;
+}
+
+// The excess over running every batch at the steady-state time is the cold-start cost
+void warmup_write(struct worker* worker, FILE* file, size_t work_size, int threads) {
+    struct warmup_stats* stats = &worker->warmup;
+    uint64_t steady_ns = (uint64_t)stats->batches * stats->steady_batch_ns;
+
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        fprintf(file, "%i,%i,", threads, worker->thread_id);
+    }
+    fprintf(file, "%zu,%d,%lu,%lu,%lu,%lu,%ld,%d\n", work_size, stats->batches, stats->iterations,
+            stats->elapsed_ns, stats->first_batch_ns, stats->steady_batch_ns,
+            (int64_t)(stats->elapsed_ns - steady_ns), stats->converged);
+}
+
+// Result files shared by all workers, only written by thread 0
+static FILE* latency_log = NULL;
+static FILE* histogram_log = NULL;
+static FILE* throughput_log = NULL;
+static FILE* thread_throughput_log = NULL;
+static FILE* perf_log = NULL;
+static FILE* power_log = NULL;
+static FILE* setup_log = NULL;
+
+#ifdef CONFIG_MEASURE_LATENCY
+// Raw latency samples in binary columnar form, and the indices of its columns
+static struct columnar_file* latency_columns = NULL;
+static int latency_column_threads, latency_column_thread_id, latency_column_work_size, latency_column_latency;
+#endif
+
+#ifdef CONFIG_MEASURE_POWER
+// Energy is a package-wide quantity, so thread 0 samples it around all workers at once
+static struct energy_meter energy_meter;
+static struct timer        energy_timer;
+#endif
+
+#ifdef CONFIG_MEASURE_LATENCY
+#define WRITER_RING_SIZE        64          // Completed sample buffers that can be queued
+#define WRITER_BUFFER_SIZE      (1 << 20)   // Formatted output is written in chunks of this size
+#define WRITER_IDLE_SLEEP_NS    50000
+
+enum write_request_type {
+    WRITE_REQUEST_SAMPLES,
+    WRITE_REQUEST_STOP,
+};
+
+// A completed buffer of raw samples. Ownership of runs passes to the writer, which unmaps it.
+struct write_request {
+    enum write_request_type type;
+    int                     threads;
+    int                     thread_id;
+    size_t                  work_size;
+    struct timer*           runs;
+    size_t                  count;
+};
+
+// Result writer thread fed through a lock-free single-producer/single-consumer ring.
+// Thread 0 hands over raw sample buffers between work sizes and immediately moves on,
+// while formatting and I/O happen on a CPU that does not run a worker.
+struct writer {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t head;   // Next slot to fill, only written by the producer
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t tail;   // Next slot to drain, only written by the writer
+    _Alignas(CACHE_LINE_SIZE) struct write_request ring[WRITER_RING_SIZE];
+    pthread_t   thread;
+    int         fd;
+    char*       buffer;
+    size_t      buffer_length;
+};
+
+static struct writer result_writer;
+
+static void writer_flush(struct writer* writer) {
+    size_t written = 0;
+    while (written < writer->buffer_length) {
+        ssize_t res = write(writer->fd, writer->buffer + written, writer->buffer_length - written);
+        if (res < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            break;
+        }
+        written += (size_t)res;
+    }
+    writer->buffer_length = 0;
+}
+
+// Appends the decimal representation of value to the output buffer
+static inline char* format_u64(char* out, uint64_t value) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while (length) {
+        *out++ = digits[--length];
+    }
+    return out;
+}
+
+static void writer_write_csv(struct writer* writer, struct write_request* request) {
+    // Longest possible row: five 20 digit numbers and their separators
+    const size_t max_row_length = 5 * 21;
+
+    for (size_t i = 0; i < request->count; ++i) {
+        if (writer->buffer_length + max_row_length > WRITER_BUFFER_SIZE) {
+            writer_flush(writer);
+        }
+
+        char* out = writer->buffer + writer->buffer_length;
+        if (EXPERIMENT_THREAD_MAX > 0) {
+            out = format_u64(out, request->threads);
+            *out++ = ',';
+            out = format_u64(out, request->thread_id);
+            *out++ = ',';
+        }
+        out = format_u64(out, i);
+        *out++ = ',';
+        out = format_u64(out, latency_value(&request->runs[i]));
+        *out++ = ',';
+        out = format_u64(out, request->work_size);
+        *out++ = '\n';
+        writer->buffer_length = out - writer->buffer;
+    }
+}
+
+void* writer_main(void* arg) {
+    struct writer* writer = arg;
+
+    while (1) {
+        uint64_t tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&writer->head, memory_order_acquire)) {
+            struct timespec idle = { 0, WRITER_IDLE_SLEEP_NS };
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        struct write_request* request = &writer->ring[tail % WRITER_RING_SIZE];
+        if (request->type == WRITE_REQUEST_STOP) {
+            break;
+        }
+
+        if (latency_columns) {
+            columnar_append_run(latency_columns, latency_column_threads, request->threads, request->count);
+            columnar_append_run(latency_columns, latency_column_thread_id, request->thread_id, request->count);
+            columnar_append_run(latency_columns, latency_column_work_size, request->work_size, request->count);
+            columnar_append_timers(latency_columns, latency_column_latency, request->runs, request->count);
+        } else {
+            writer_write_csv(writer, request);
+        }
+        workload_free(request->runs);
+
+        atomic_store_explicit(&writer->tail, tail + 1, memory_order_release);
+    }
+
+    if (writer->fd != -1) {
+        writer_flush(writer);
+    }
+    return NULL;
+}
+
+// Queues a request, waiting for the writer only if the ring is full
+void writer_submit(struct writer* writer, struct write_request request) {
+    uint64_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&writer->tail, memory_order_acquire) == WRITER_RING_SIZE) {
+        sched_yield();
+    }
+
+    writer->ring[head % WRITER_RING_SIZE] = request;
+    atomic_store_explicit(&writer->head, head + 1, memory_order_release);
+}
+
+// Starts the writer on the given CPU, or unpinned if cpu is -1. CSV output goes to fd,
+// which must not be written through stdio while the writer runs.
+void writer_start(struct writer* writer, int fd, int cpu) {
+    atomic_store(&writer->head, 0);
+    atomic_store(&writer->tail, 0);
+    writer->fd = fd;
+    writer->buffer_length = 0;
+    writer->buffer = aligned_alloc(4096, WRITER_BUFFER_SIZE);
+    if (!writer->buffer) {
+        fprintf(stderr, "Failed to allocate the result writer buffer.\n");
+        exit(1);
+    }
+
+    // Under --isolate the main thread runs SCHED_FIFO, the writer explicitly does not, so it
+    // never competes with the workers as a real-time thread
+    pthread_attr_t attr;
+    struct sched_param param = { .sched_priority = 0 };
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&attr, &param);
+    int res = pthread_create(&writer->thread, &attr, writer_main, writer);
+    pthread_attr_destroy(&attr);
+    if (res != 0) {
+        fprintf(stderr, "Failed to create result writer thread: %s\n", strerror(res));
+        exit(1);
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        pthread_setaffinity_np(writer->thread, sizeof(cpu_set), &cpu_set);
+    }
+}
+
+void writer_stop(struct writer* writer) {
+    writer_submit(writer, (struct write_request){ .type = WRITE_REQUEST_STOP });
+    pthread_join(writer->thread, NULL);
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+// Picks an allowed CPU that no worker is pinned to, or -1 if every CPU runs a worker
+int writer_pick_cpu() {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        for (int t = 0; t < EXPERIMENT_THREAD_MAX && t < worker_cpu_count; ++t) {
+            CPU_CLR(worker_cpus[t], &cpu_set);
+        }
+    } else {
+        // The single-threaded worker runs unpinned on the main thread, avoid its current CPU
+        int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            CPU_CLR(cpu, &cpu_set);
+        }
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpu_set)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+#endif
+
+// Writes the results of every worker for one work size. Runs on thread 0 while the
+// other workers wait on the barrier, so no worker buffer is modified concurrently.
+void benchmark_report(int thread_count, size_t work_size) {
+#ifdef CONFIG_MEASURE_THROUGHPUT
+    // Aggregate wall time spans from the earliest start to the latest stop of any worker
+    struct timer wall_timer = workers[0].outer_timer;
+    for (int t = 1; t < thread_count; ++t) {
+        if (workers[t].outer_timer.start < wall_timer.start) wall_timer.start = workers[t].outer_timer.start;
+        if (workers[t].outer_timer.end > wall_timer.end) wall_timer.end = workers[t].outer_timer.end;
+    }
+
+    uint64_t elapsed_time = get_elapsed_ns(&wall_timer);
+    uint64_t worker_calls = (uint64_t)worker_loop_count * CALLS_PER_ITERATION;
+    uint64_t total_iterations = worker_calls * thread_count;
+    
+    double ops_per_sec = elapsed_time ? total_iterations / (elapsed_time / 1e9) : 0;
+
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        printf("Threads             : %d\n", thread_count);
+        fprintf(throughput_log, "%i,", thread_count);
+    }
+    // Bytes per second stays empty unless the benchmark declares how much data one call touches
+    fprintf(throughput_log, "%zu,%lu,%lu,%f,", work_size, total_iterations, elapsed_time, ops_per_sec);
+    if (EXPERIMENT_BYTES_PER_OP > 0) fprintf(throughput_log, "%f", ops_per_sec * EXPERIMENT_BYTES_PER_OP);
+    fprintf(throughput_log, ",%d,%s\n", EXPERIMENT_RUN_ID,
+            EXPERIMENT_CONFIGURATION_NAME ? EXPERIMENT_CONFIGURATION_NAME : "default");
+
+    // Every worker makes the same number of calls, so a worker that loses out on shared resources
+    // takes longer. Its share of the summed per-worker throughput, and Jain's index over all
+    // shares (1 when they are equal, 1 / threads when one worker gets everything), measure fairness.
+    if (thread_throughput_log) {
+        double rate_sum = 0, rate_squares = 0;
+        for (int t = 0; t < thread_count; ++t) {
+            uint64_t worker_ns = get_elapsed_ns(&workers[t].outer_timer);
+            double rate = worker_ns ? worker_calls / (worker_ns / 1e9) : 0;
+            rate_sum += rate;
+            rate_squares += rate * rate;
+        }
+        double fairness = rate_squares > 0 ? rate_sum * rate_sum / (thread_count * rate_squares) : 1;
+        for (int t = 0; t < thread_count; ++t) {
+            uint64_t worker_ns = get_elapsed_ns(&workers[t].outer_timer);
+            double rate = worker_ns ? worker_calls / (worker_ns / 1e9) : 0;
+            fprintf(thread_throughput_log, "%i,%i,%zu,%lu,%lu,%f,%f,%f\n", thread_count, t, work_size, worker_calls,
+                    worker_ns, rate, rate_sum > 0 ? rate / rate_sum : 0, fairness);
+        }
+        printf("Fairness            : %f (Jain's index of the per-thread throughput)\n", fairness);
+    }
+
+    printf("Total elapsed time  : %ld\n", elapsed_time);
+    printf("Total iterations    : %lu\n", total_iterations);
+    printf("Throughput          : %f iterations per second\n", ops_per_sec);
+    if (EXPERIMENT_BYTES_PER_OP > 0) {
+        printf("Bandwidth           : %f bytes per second\n", ops_per_sec * EXPERIMENT_BYTES_PER_OP);
+    }
+#endif
+
+#ifdef CONFIG_MEASURE_LATENCY
+    for (int t = 0; t < thread_count; ++t) {
+        struct worker* worker = &workers[t];
+        if (EXPERIMENT_LATENCY_RAW_SAMPLES) {
+            // The writer thread takes over the sample buffer, the worker maps a fresh one
+            writer_submit(&result_writer, (struct write_request){
+                .type = WRITE_REQUEST_SAMPLES,
+                .threads = thread_count,
+                .thread_id = t,
+                .work_size = work_size,
+                .runs = worker->runs,
+                .count = (size_t)worker_loop_count,
+            });
+            worker->runs = NULL;
+        } else {
+            histogram_write_summary(&worker->histogram, latency_log, work_size, thread_count, t);
+            histogram_write_binary(&worker->histogram, histogram_log, work_size, thread_count, t);
+        }
+    }
+#endif
+
+#ifdef CONFIG_MEASURE_POWER
+    energy_meter_write(&energy_meter, power_log, work_size, thread_count,
+                       (uint64_t)worker_loop_count * CALLS_PER_ITERATION * thread_count, get_elapsed_ns(&energy_timer));
+#endif
+
+#ifdef CONFIG_MEASURE_PERF
+    for (int t = 0; t < thread_count; ++t) {
+        perf_counters_write(&workers[t].perf, perf_log, work_size, thread_count, t,
+                            (uint64_t)worker_loop_count * CALLS_PER_ITERATION, get_elapsed_ns(&workers[t].outer_timer));
+    }
+#endif
+
+    if (warmup_log) {
+        for (int t = 0; t < thread_count; ++t) {
+            warmup_write(&workers[t], warmup_log, work_size, thread_count);
+        }
+    }
+
+    for (int t = 0; t < thread_count; ++t) {
+        if (EXPERIMENT_THREAD_MAX > 0) {
+            fprintf(setup_log, "%i,%i,", thread_count, t);
+        }
+        fprintf(setup_log, "%zu,%lu,%lu\n", work_size, workers[t].setup_ns, workers[t].teardown_ns);
+    }
+}
+
+void* benchmark_worker(void* arg) {
+    struct worker* worker = arg;
+
+    // Spawned workers pin themselves, the single-threaded mode runs unpinned on the main thread
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(worker->cpu, &cpu_set);
+        int res = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (res != 0) {
+            fprintf(stderr, "Failed to pin thread %d to CPU %d: %s\n", worker->thread_id, worker->cpu, strerror(res));
+        }
+    }
+
+#ifdef CONFIG_MEASURE_PERF
+    // Counters follow the opening thread, so every worker opens its own group
+    if (!perf_counters_open(&worker->perf) && worker->thread_id == 0) {
+        fprintf(stderr, "Warning: hardware performance counters unavailable (%s), recording elapsed time only.\n", strerror(errno));
+    }
+#endif
+
+    for (int w = 0; w < EXPERIMENT_WORK_SIZE_COUNT; ++w) {
+        size_t work_size = EXPERIMENT_WORK_SIZES[w];
+
+    #ifdef CONFIG_MEASURE_LATENCY
+        if (!EXPERIMENT_LATENCY_RAW_SAMPLES) {
+            histogram_reset(&worker->histogram);
+        }
+    #endif
+
+        // Pre-warming the runtime environment only once
+        if (w == 0) {
+            struct timer prefault_timer;
+            timer_start(&prefault_timer); // Prefault timer code and vDSO pages
+            timer_stop(&prefault_timer);
+        }
+
+        // Per-size setup is timed on its own, outside the measured loop
+        struct timer setup_timer;
+        worker->context.work_size = work_size;
+        worker->context.rng_state = EXPERIMENT_SEED ^ ((uint64_t)worker->thread_id << 48) ^ (work_size * 0x9e3779b97f4a7c15ULL);
+        timer_start(&setup_timer);
+        setup_work_size(&worker->context);
+        timer_stop(&setup_timer);
+        worker->setup_ns = get_elapsed_ns(&setup_timer);
+
+        // Every work size starts with a cold working set, so each one is warmed up
+        if (EXPERIMENT_WARMUP == WARMUP_STEADY) {
+            warmup_run(worker);
+        }
+
+        if (EXPERIMENT_LOOP_CALIBRATION != LOOP_CALIBRATION_OFF) {
+            calibration_pilot(worker);
+            pthread_barrier_wait(&worker_barrier);
+            if (worker->thread_id == 0) {
+                worker_loop_count = calibration_loop_count(worker->thread_count);
+                calibration_write(calibration_log, work_size, worker->thread_count, worker_loop_count);
+            }
+            pthread_barrier_wait(&worker_barrier);
+        }
+
+    #ifdef CONFIG_MEASURE_LATENCY
+        // Raw samples keep one timer per iteration, sized for this work size's loop count
+        if (EXPERIMENT_LATENCY_RAW_SAMPLES) {
+            worker->runs = workload_alloc(sizeof(struct timer) * worker_loop_count, 0,
+                                          EXPERIMENT_SAMPLE_PAGES | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+            if (!worker->runs) {
+                fprintf(stderr, "Failed to allocate %d latency samples: %s\n", worker_loop_count, strerror(errno));
+                exit(1);
+            }
+        }
+    #endif
+
+        // Release all workers into the measured loop together
+        pthread_barrier_wait(&worker_barrier);
+        
+        // Actual benchmark phase, energy is metered once every worker has finished its setup
+    #ifdef CONFIG_MEASURE_POWER
+        if (worker->thread_id == 0) {
+            energy_meter_start(&energy_meter);
+            timer_start(&energy_timer);
+        }
+    #endif
+    #ifdef CONFIG_MEASURE_PERF
+        perf_counters_start(&worker->perf);
+    #endif
+        timer_start(&worker->outer_timer);
+        
+        for (int i = 0; i < worker_loop_count; ++i) {
+    #ifdef CONFIG_MEASURE_LATENCY
+            struct timer *sample = EXPERIMENT_LATENCY_RAW_SAMPLES ? &worker->runs[i] : &worker->latency_sample;
+            timer_start(sample);
+    #endif
+    #ifdef CONFIG_MEASURE_LATENCY_BATCHED
+            LATENCY_BATCH(worker->context.iteration = (uint64_t)i * LATENCY_BATCH_SIZE + batch_call;
+                          benchmark_function(&worker->context));
+    #else
+            worker->context.iteration = i;
+            benchmark_function(&worker->context);
+    #endif
+
+    #ifdef CONFIG_MEASURE_LATENCY
+            timer_stop(sample);
+            if (!EXPERIMENT_LATENCY_RAW_SAMPLES) {
+                histogram_record(&worker->histogram, latency_value(sample));
+            }
+    #endif
+        }
+
+        timer_stop(&worker->outer_timer);
+    #ifdef CONFIG_MEASURE_PERF
+        perf_counters_stop(&worker->perf);
+    #endif
+
+        // Wait for every worker to finish before tearing down and reporting, then hold them until the report is written
+        pthread_barrier_wait(&worker_barrier);
+    #ifdef CONFIG_MEASURE_POWER
+        if (worker->thread_id == 0) {
+            timer_stop(&energy_timer);
+            energy_meter_stop(&energy_meter);
+        }
+    #endif
+
+        struct timer teardown_timer;
+        timer_start(&teardown_timer);
+        teardown_work_size(&worker->context);
+        timer_stop(&teardown_timer);
+        worker->teardown_ns = get_elapsed_ns(&teardown_timer);
+
+        pthread_barrier_wait(&worker_barrier);
+        if (worker->thread_id == 0) {
+            benchmark_report(worker->thread_count, work_size);
+        }
+        pthread_barrier_wait(&worker_barrier);
+    }
+
+#ifdef CONFIG_MEASURE_PERF
+    perf_counters_close(&worker->perf);
+#endif
+    return NULL;
+}
+
+void benchmark() {
+    // Columns identifying the thread count and worker are only present in thread sweeps
+    const char* thread_columns = (EXPERIMENT_THREAD_MAX > 0) ? "threads,thread_id," : "";
+    (void)thread_columns;
+
+#ifdef CONFIG_MEASURE_LATENCY
+    if (EXPERIMENT_LATENCY_RAW_SAMPLES && EXPERIMENT_OUTPUT_BINARY) {
+        // Rows within a run of equal work size and thread are in iteration order
+        latency_columns = columnar_create("latencies.bin");
+        latency_column_threads = columnar_add_column(latency_columns, "threads", COLUMNAR_U32, COLUMNAR_RLE);
+        latency_column_thread_id = columnar_add_column(latency_columns, "thread_id", COLUMNAR_U32, COLUMNAR_RLE);
+        latency_column_work_size = columnar_add_column(latency_columns, "work_size", COLUMNAR_U64, COLUMNAR_RLE);
+        latency_column_latency = columnar_add_column(latency_columns, "latency" LATENCY_UNIT_SUFFIX, COLUMNAR_U64, COLUMNAR_PLAIN);
+    } else if (EXPERIMENT_LATENCY_RAW_SAMPLES) {
+        latency_log = create_data_output_file("latencies.csv");
+        fprintf(latency_log, "%siteration,latency" LATENCY_UNIT_SUFFIX ",work_size\n", thread_columns);
+        fflush(latency_log);
+    } else {
+        latency_log = create_data_output_file("latency_summary.csv");
+        fprintf(latency_log, "%swork_size,count,min%s,mean%s,p50%s,p90%s,p99%s,p99_9%s,p99_99%s,max%s\n", thread_columns,
+                LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX,
+                LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX, LATENCY_UNIT_SUFFIX);
+        histogram_log = create_data_output_file("latency_histogram.bin");
+        fwrite(HISTOGRAM_MAGIC, 1, strlen(HISTOGRAM_MAGIC), histogram_log);
+    }
+#endif
+
+#ifdef CONFIG_MEASURE_LATENCY
+    if (EXPERIMENT_LATENCY_RAW_SAMPLES) {
+        writer_start(&result_writer, latency_log ? fileno(latency_log) : -1, writer_pick_cpu());
+    }
+#endif
+
+#ifdef CONFIG_MEASURE_THROUGHPUT
+    throughput_log = create_data_output_file("throughput.csv");
+    fprintf(throughput_log, "%swork_size,iterations,elapsed_ns,ops_per_sec,bytes_per_sec,run_id,configuration\n",
+            (EXPERIMENT_THREAD_MAX > 0) ? "threads," : "");
+    if (EXPERIMENT_THREAD_MAX > 0) {
+        thread_throughput_log = create_data_output_file("thread_throughput.csv");
+        fprintf(thread_throughput_log, "threads,thread_id,work_size,iterations,elapsed_ns,ops_per_sec,share,fairness\n");
+    }
+#endif
+
+#ifdef CONFIG_MEASURE_PERF
+    perf_log = create_data_output_file("perf_counters.csv");
+    fprintf(perf_log, "%swork_size,iterations,elapsed_ns", thread_columns);
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        fprintf(perf_log, ",%s", perf_counter_events[i].name);
+    }
+    fprintf(perf_log, ",ipc,cache_mpki,branch_mpki\n");
+#endif
+
+#ifdef CONFIG_MEASURE_POWER
+    energy_meter_open(&energy_meter, EXPERIMENT_POWER_SOURCE, EXPERIMENT_POWER_SIMULATED_WATTS);
+    power_log = create_data_output_file("power.csv");
+    fprintf(power_log, "%swork_size,iterations,source,domain,elapsed_ns,joules,avg_watts,nj_per_iteration\n",
+            (EXPERIMENT_THREAD_MAX > 0) ? "threads," : "");
+#endif
 
-void setup() {
-    // Any experimental prep work or setup goes here
-}
+    setup_log = create_data_output_file("setup.csv");
+    fprintf(setup_log, "%swork_size,setup_ns,teardown_ns\n", thread_columns);
 
-void cleanup() {
-    // Cleanup work goes here
-}
+    if (EXPERIMENT_WARMUP == WARMUP_STEADY) {
+        warmup_log = create_data_output_file("warmup.csv");
+        fprintf(warmup_log, "%swork_size,batches,iterations,elapsed_ns,first_batch_ns,steady_batch_ns,excess_ns,converged\n",
+                thread_columns);
+    }
 
-static inline __attribute__((always_inline)) void benchmark_function() {
-    // Benchmark workload
-}
+    if (EXPERIMENT_LOOP_CALIBRATION != LOOP_CALIBRATION_OFF) {
+        calibration_log = create_data_output_file("calibration.csv");
+        fprintf(calibration_log, "%swork_size,mode,pilot_iterations,pilot_mean_ns,pilot_stddev_ns,loop_count\n",
+                (EXPERIMENT_THREAD_MAX > 0) ? "threads," : "");
+    }
+    worker_loop_count = EXPERIMENT_LOOP_COUNT;
 
-void benchmark() {
-#ifdef CONFIG_MEASURE_LATENCY
-    FILE* log = create_data_output_file("latencies.csv");
-    fprintf(log, "iteration,latency,work_size\n");
-#endif
+    // Without a thread sweep a single worker runs directly on the main thread
+    int thread_min = (EXPERIMENT_THREAD_MAX > 0) ? EXPERIMENT_THREAD_MIN : 1;
+    int thread_max = (EXPERIMENT_THREAD_MAX > 0) ? EXPERIMENT_THREAD_MAX : 1;
 
-    for (int work_size = EXPERIMENT_WORK_MIN_SIZE; work_size <= EXPERIMENT_WORK_MAX_SIZE; work_size += EXPERIMENT_WORK_SIZE_STEP) {
-        struct timer *runs = mmap(NULL, sizeof(struct timer) * EXPERIMENT_LOOP_COUNT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        memset(runs, 0, sizeof(struct timer) * EXPERIMENT_LOOP_COUNT);
+    for (int thread_count = thread_min; thread_count <= thread_max; thread_count += EXPERIMENT_THREAD_STEP) {
+        workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct worker) * thread_count);
+        if (!workers) {
+            fprintf(stderr, "Failed to allocate %d workers.\n", thread_count);
+            exit(1);
+        }
+        memset(workers, 0, sizeof(struct worker) * thread_count);
+        pthread_barrier_init(&worker_barrier, NULL, thread_count);
 
-        // Pre-warming the runtime environment only once
-        if (work_size == EXPERIMENT_WORK_MIN_SIZE) {
-            struct timespec prefault_ts;
-            clock_gettime(CLOCK_MONOTONIC, &prefault_ts); // Prefault clock_gettime memory
-            (void)prefault_ts;
-            
-            // Warmup phase
-            for (int i = 0; i < (int)(EXPERIMENT_LOOP_COUNT * 0.01); ++i) {
-                benchmark_function();
+        for (int t = 0; t < thread_count; ++t) {
+            workers[t].thread_id = t;
+            workers[t].thread_count = thread_count;
+            workers[t].cpu = worker_cpus[t % worker_cpu_count];
+            workers[t].context.thread_id = t;
+            workers[t].context.thread_count = thread_count;
+        #ifdef CONFIG_MEASURE_LATENCY
+            if (!EXPERIMENT_LATENCY_RAW_SAMPLES) {
+                histogram_init(&workers[t].histogram, EXPERIMENT_LATENCY_PRECISION);
             }
+        #endif
         }
-        
-        // Actual benchmark phase
-        struct timer outer_timer;
-        timer_start(&outer_timer);
-        
-        for (int i = 0; i < EXPERIMENT_LOOP_COUNT; ++i) {
-    #ifdef CONFIG_MEASURE_LATENCY
-            timer_start(&runs[i]);
-    #endif
-            benchmark_function();
 
-    #ifdef CONFIG_MEASURE_LATENCY
-            timer_stop(&runs[i]);
-    #endif
+        if (EXPERIMENT_THREAD_MAX > 0) {
+            if (thread_count > worker_cpu_count) {
+                fprintf(stderr, "Warning: %d threads share %d CPUs.\n", thread_count, worker_cpu_count);
+            }
+            for (int t = 0; t < thread_count; ++t) {
+                int res = pthread_create(&workers[t].thread, NULL, benchmark_worker, &workers[t]);
+                if (res != 0) {
+                    fprintf(stderr, "Failed to create worker thread: %s\n", strerror(res));
+                    exit(1);
+                }
+            }
+            for (int t = 0; t < thread_count; ++t) {
+                pthread_join(workers[t].thread, NULL);
+            }
+        } else {
+            benchmark_worker(&workers[0]);
         }
 
-        timer_stop(&outer_timer);
-
-    #ifdef CONFIG_MEASURE_THROUGHPUT
-        uint64_t elapsed_time = get_elapsed_ns(&outer_timer);
-        
-        printf("Total elapsed time  : %ld\n", elapsed_time);
-        printf("Total iterations    : %d\n", EXPERIMENT_LOOP_COUNT);
-        printf("Throughput          : %f iterations per second\n", EXPERIMENT_LOOP_COUNT / (elapsed_time / 1e9));
-    #endif
-
+        pthread_barrier_destroy(&worker_barrier);
     #ifdef CONFIG_MEASURE_LATENCY
-        for (int i = 0; i < EXPERIMENT_LOOP_COUNT; ++i) {
-            uint64_t latency_measure = get_elapsed_ns(&runs[i]);
-            fprintf(log, "%i,%ld,%i\n", i, latency_measure, work_size);
+        if (!EXPERIMENT_LATENCY_RAW_SAMPLES) {
+            for (int t = 0; t < thread_count; ++t) {
+                histogram_free(&workers[t].histogram);
+            }
         }
     #endif
-        
-        munmap(runs, sizeof(struct timer) * EXPERIMENT_LOOP_COUNT);
+        free(workers);
+        workers = NULL;
     }
 
 #ifdef CONFIG_MEASURE_LATENCY
-    fclose(log);
+    if (EXPERIMENT_LATENCY_RAW_SAMPLES) {
+        writer_stop(&result_writer);
+    }
+    columnar_close(latency_columns);
+#endif
+    if (latency_log) fclose(latency_log);
+    if (histogram_log) fclose(histogram_log);
+    if (throughput_log) fclose(throughput_log);
+    if (thread_throughput_log) fclose(thread_throughput_log);
+    if (perf_log) fclose(perf_log);
+    if (power_log) fclose(power_log);
+    if (calibration_log) fclose(calibration_log);
+    if (warmup_log) fclose(warmup_log);
+    if (setup_log) fclose(setup_log);
+
+#ifdef CONFIG_MEASURE_POWER
+    energy_meter_close(&energy_meter);
 #endif
 }
 
 int main() {
-    load_config(CONFIG_PATH);
+    if (!find_experiment_root(EXPERIMENT_ROOT)) {
+        fprintf(stderr, "Unable to locate the experiment directory containing %s.\n", CONFIG_PATH);
+        exit(1);
+    }
+
+    char config_path[PATH_MAX + sizeof(CONFIG_PATH)];
+    snprintf(config_path, sizeof(config_path), "%s/%s", EXPERIMENT_ROOT, CONFIG_PATH);
+    load_config(config_path);
     
     EXPERIMENT_VERSION = get_config_string("experiment_version");
-    EXPERIMENT_LOOP_COUNT = get_config_int("experiment_loop_count");
-    EXPERIMENT_WORK_MIN_SIZE = get_config_int("experiment_work_min_size");
-    EXPERIMENT_WORK_MAX_SIZE = get_config_int("experiment_work_max_size");
-    EXPERIMENT_WORK_SIZE_STEP = get_config_int("experiment_work_size_step");
-    EXPERIMENT_RUN_ID = get_config_int("experiment_run_id");
+    EXPERIMENT_LOOP_COUNT = (int)get_config_int64("experiment_loop_count", 1, 1, INT_MAX);
+
+    // With calibration, experiment_loop_count bounds the count picked for each work size
+    static const char* const calibration_modes[] = { "off", "time", "error", NULL };
+    EXPERIMENT_LOOP_CALIBRATION = get_config_choice("experiment_loop_calibration", calibration_modes, LOOP_CALIBRATION_OFF);
+    EXPERIMENT_LOOP_MIN_COUNT = (int)get_config_int64("experiment_loop_min_count", 10, 1, INT_MAX);
+    if (EXPERIMENT_LOOP_MIN_COUNT > EXPERIMENT_LOOP_COUNT) {
+        EXPERIMENT_LOOP_MIN_COUNT = EXPERIMENT_LOOP_COUNT;
+    }
+    struct config_entry* target_time = config_find("experiment_target_time");
+    struct config_entry* target_error = config_find("experiment_target_error");
+    EXPERIMENT_TARGET_TIME = target_time ? config_entry_double(target_time) : 0.5;
+    EXPERIMENT_TARGET_ERROR = target_error ? config_entry_double(target_error) : 0.01;
+    if (EXPERIMENT_LOOP_CALIBRATION == LOOP_CALIBRATION_TIME && EXPERIMENT_TARGET_TIME <= 0) {
+        fprintf(stderr, "Time calibration needs a positive experiment_target_time in seconds.\n");
+        exit(1);
+    }
+    if (EXPERIMENT_LOOP_CALIBRATION == LOOP_CALIBRATION_ERROR && (EXPERIMENT_TARGET_ERROR <= 0 || EXPERIMENT_TARGET_ERROR >= 1)) {
+        fprintf(stderr, "Error calibration needs experiment_target_error between 0 and 1, e.g. 0.01 for 1%%.\n");
+        exit(1);
+    }
+    EXPERIMENT_WORK_MIN_SIZE = get_config_size("experiment_work_min_size", 0);
+    EXPERIMENT_WORK_MAX_SIZE = get_config_size("experiment_work_max_size", 0);
+    EXPERIMENT_WORK_SIZE_STEP = get_config_size("experiment_work_size_step", 1);
+    EXPERIMENT_RUN_ID = (int)get_config_int64("experiment_run_id", 0, 0, INT_MAX);
     EXPERIMENT_CONFIGURATION_NAME = get_config_string("experiment_run_configuration");
+    EXPERIMENT_SEED = (uint64_t)get_config_int64("experiment_seed", 1, INT64_MIN, INT64_MAX);
+    EXPERIMENT_BYTES_PER_OP = get_config_size("experiment_bytes_per_op", 0);
+
+    static const char* const warmup_modes[] = { "off", "steady", NULL };
+    EXPERIMENT_WARMUP = get_config_choice("experiment_warmup", warmup_modes, WARMUP_STEADY);
+    EXPERIMENT_WARMUP_BATCH_SIZE = (int)get_config_int64("experiment_warmup_batch_size", 100, 1, INT_MAX);
+    EXPERIMENT_WARMUP_WINDOW = (int)get_config_int64("experiment_warmup_window", 8, 2, WARMUP_MAX_WINDOW);
+    EXPERIMENT_WARMUP_MAX_BATCHES = (int)get_config_int64("experiment_warmup_max_batches", 200, 1, INT_MAX);
+    struct config_entry* warmup_tolerance = config_find("experiment_warmup_tolerance");
+    EXPERIMENT_WARMUP_TOLERANCE = warmup_tolerance ? config_entry_double(warmup_tolerance) : 0.02;
+    EXPERIMENT_LATENCY_RAW_SAMPLES = get_config_bool("experiment_latency_raw_samples");
+    static const char* const output_formats[] = { "csv", "binary", NULL };
+    EXPERIMENT_OUTPUT_BINARY = get_config_choice("experiment_output_format", output_formats, 0);
+
+    // Page size of the raw sample buffers, populated before the measured loop either way
+    static const char* const sample_pages[] = { "default", "thp", "2mb", "1gb", NULL };
+    static const int sample_page_flags[] = { 0, WORKLOAD_PAGES_THP, WORKLOAD_PAGES_2MB, WORKLOAD_PAGES_1GB };
+    EXPERIMENT_SAMPLE_PAGES = sample_page_flags[get_config_choice("experiment_sample_pages", sample_pages, 1)];
+
+    // Histogram precision is given in significant decimal digits
+    EXPERIMENT_LATENCY_PRECISION = (int)get_config_int64("experiment_latency_precision", 3, 1, 5);
+
+    // A thread sweep is enabled by a positive experiment_thread_max
+    EXPERIMENT_THREAD_MIN = (int)get_config_int64("experiment_thread_min", 1, 1, INT_MAX);
+    EXPERIMENT_THREAD_MAX = (int)get_config_int64("experiment_thread_max", 0, 0, INT_MAX);
+    EXPERIMENT_THREAD_STEP = (int)get_config_int64("experiment_thread_step", 1, 1, INT_MAX);
+    EXPERIMENT_THREAD_CPUS = get_config_string("experiment_thread_cpus");
+    EXPERIMENT_POWER_SOURCE = get_config_string("experiment_power_source");
+    EXPERIMENT_POWER_SIMULATED_WATTS = get_config_double("experiment_power_simulated_watts");
+
+    // Keys read by tools/run_experiment.sh rather than the benchmark
+    config_find("experiment_iterations");
+    config_find("experiment_configurations");
+    config_find("workload_template");     // Recorded by the experiment wizard
+
+    // Workers are pinned round-robin to the configured CPUs, or to the CPUs this process may run on
+    worker_cpus = malloc(sizeof(int) * CPU_SETSIZE);
+    if (EXPERIMENT_THREAD_CPUS && strlen(EXPERIMENT_THREAD_CPUS) > 0) {
+        worker_cpu_count = parse_cpu_list(EXPERIMENT_THREAD_CPUS, worker_cpus, CPU_SETSIZE);
+    } else {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                worker_cpus[worker_cpu_count++] = cpu;
+            }
+        }
+    }
+    if (worker_cpu_count == 0) {
+        fprintf(stderr, "No usable CPUs in experiment_thread_cpus '%s'.\n", EXPERIMENT_THREAD_CPUS);
+        exit(1);
+    }
+
+    // Cache-aware sweeps read the caches of the first worker CPU, so build them after the CPU list
+    EXPERIMENT_WORK_SIZE_COUNT = build_work_sizes(&EXPERIMENT_WORK_SIZES);
     
+    // Set by exp run --isolate, which prepares the rest of the machine
+    EXPERIMENT_ISOLATE = get_config_bool("experiment_isolate");
+    if (EXPERIMENT_ISOLATE && isolate_process()) {
+        // A SCHED_FIFO worker spinning on a shared CPU can starve the other threads there
+        // indefinitely, so the sweep never runs more workers than there are CPUs
+        if (EXPERIMENT_THREAD_MAX > worker_cpu_count) {
+            fprintf(stderr, "Warning: SCHED_FIFO workers need a CPU each, capping experiment_thread_max at %d.\n",
+                    worker_cpu_count);
+            EXPERIMENT_THREAD_MAX = worker_cpu_count;
+        }
+        if (EXPERIMENT_THREAD_MAX > 0 && EXPERIMENT_THREAD_MIN > EXPERIMENT_THREAD_MAX) {
+            fprintf(stderr, "experiment_thread_min %d exceeds the %d CPUs available to SCHED_FIFO workers.\n",
+                    EXPERIMENT_THREAD_MIN, worker_cpu_count);
+            exit(1);
+        }
+    }
+
+    timer_init();
+#ifdef CONFIG_MEASURE_LATENCY_BATCHED
+    latency_baseline_init();
+#endif
     setup();
     benchmark();
     cleanup();
+    config_report_unused();
     
     free(EXPERIMENT_VERSION);
     free(EXPERIMENT_CONFIGURATION_NAME);
+    free(EXPERIMENT_THREAD_CPUS);
+    free(EXPERIMENT_POWER_SOURCE);
+    free(worker_cpus);
+    free(EXPERIMENT_WORK_SIZES);
+    free_config();
     return 0;
 }
 
@@ -176,76 +2329,678 @@ char* trim_whitespace(char* str) {
     return str;
 }
 
+// Walks up from the directory of the executable until a directory containing the
+// experiment config is found, so binaries can live in per-configuration build directories
+int find_experiment_root(char* root) {
+    char exe_path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    if (length == -1) {
+        perror("readlink");
+        return 0;
+    }
+    exe_path[length] = '\0';
+
+    char* dir = dirname(exe_path);
+    while (1) {
+        char candidate[PATH_MAX];
+        struct stat statbuf;
+        snprintf(candidate, sizeof(candidate), "%s/%s", dir, CONFIG_PATH);
+        if (stat(candidate, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+            snprintf(root, PATH_MAX, "%s", dir);
+            return 1;
+        }
+        if (strcmp(dir, "/") == 0 || strcmp(dir, ".") == 0) {
+            return 0;
+        }
+        dir = dirname(dir);
+    }
+}
+
+// FNV-1a, used to index the configuration store
+static uint64_t config_hash(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (; *name; ++name) {
+        hash ^= (unsigned char)*name;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Returns the slot holding name, or the empty slot it would be inserted into
+static struct config_slot* config_lookup(const char* name, uint64_t hash) {
+    size_t mask = config_store.slot_count - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        struct config_slot* slot = &config_store.slots[index];
+        if (!slot->entry || (slot->hash == hash && strcmp(slot->name, name) == 0)) {
+            return slot;
+        }
+    }
+}
+
+static void config_resize(size_t slot_count) {
+    struct config_slot* old_slots = config_store.slots;
+    size_t old_count = config_store.slot_count;
+
+    config_store.slots = calloc(slot_count, sizeof(struct config_slot));
+    config_store.slot_count = slot_count;
+    for (size_t i = 0; i < old_count; ++i) {
+        if (old_slots[i].entry) {
+            *config_lookup(old_slots[i].name, old_slots[i].hash) = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+// Indexes entry under name, keeping the table at most half full.
+// Returns the entry already stored under name if there is one.
+static struct config_entry* config_index(const char* name, struct config_entry* entry) {
+    if ((config_store.slot_used + 1) * 2 > config_store.slot_count) {
+        config_resize(config_store.slot_count * 2);
+    }
+
+    uint64_t hash = config_hash(name);
+    struct config_slot* slot = config_lookup(name, hash);
+    if (slot->entry) {
+        return slot->entry;
+    }
+    slot->hash = hash;
+    slot->name = name;
+    slot->entry = entry;
+    config_store.slot_used++;
+    return NULL;
+}
+
+// Environment variables are named after the upper-cased key, with '.' replaced by '_'. Only
+// namespaced names are honoured, so a shell variable such as PATH never overrides a key:
+// experiment_* keys already are, every other key takes an ARCHIPLEX_ prefix.
+#define CONFIG_ENV_PREFIX "ARCHIPLEX_"
+
+static const char* config_getenv(const char* key, char* env_key, size_t env_key_size) {
+    size_t length = 0;
+    if (strncmp(key, "experiment_", strlen("experiment_")) != 0) {
+        length = snprintf(env_key, env_key_size, "%s", CONFIG_ENV_PREFIX);
+    }
+    for (size_t i = 0; key[i] && length < env_key_size - 1; i++, length++) {
+        env_key[length] = key[i] == '.' ? '_' : (char)toupper((unsigned char)key[i]);
+    }
+    env_key[length] = '\0';
+    return getenv(env_key);
+}
+
+// Overrides are printed with the startup report in run.log, so a run can be reproduced
+static void config_report_override(const char* key, const char* env_key, const char* value) {
+    printf("Config override     : %s = %s (from %s)\n", key, value, env_key);
+}
+
+static struct config_entry* config_add(const char* section, const char* key, const char* value, int line) {
+    struct config_entry* entry = calloc(1, sizeof(struct config_entry));
+    entry->section = section ? strdup(section) : NULL;
+    entry->key = strdup(key);
+    entry->value = strdup(value);
+    entry->line = line;
+    if (section) {
+        entry->qualified_key = malloc(strlen(section) + strlen(key) + 2);
+        sprintf(entry->qualified_key, "%s.%s", section, key);
+    }
+
+    if (entry->qualified_key) {
+        struct config_entry* existing = config_index(entry->qualified_key, entry);
+        if (existing) {
+            fprintf(stderr, "%s:%d: duplicate key '%s' (first defined on line %d)\n",
+                    config_store.filename, line, entry->qualified_key, existing->line);
+            exit(1);
+        }
+    }
+
+    // The bare key refers to its first definition across all sections
+    struct config_entry* existing = config_index(entry->key, entry);
+    if (existing && !entry->qualified_key) {
+        fprintf(stderr, "%s:%d: duplicate key '%s' (first defined on line %d)\n",
+                config_store.filename, line, entry->key, existing->line);
+        exit(1);
+    }
+
+    if (config_store.entry_count == config_store.entry_capacity) {
+        config_store.entry_capacity = config_store.entry_capacity ? config_store.entry_capacity * 2 : 16;
+        config_store.entries = realloc(config_store.entries, sizeof(struct config_entry*) * config_store.entry_capacity);
+    }
+    config_store.entries[config_store.entry_count++] = entry;
+    return entry;
+}
+
+static char* config_lowercase(char* str) {
+    for (char* p = str; *p; ++p) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    return str;
+}
+
 void load_config(const char* filename) {
-    char line[512];
     FILE* file = fopen(filename, "r");
     if (!file) {
         fprintf(stderr, "Unable to open the config file.\n");
         exit(1);
     }
 
-    while (fgets(line, sizeof(line), file)) {
-        char* key = strtok(line, "=");
-        char* value = strtok(NULL, "\n");
+    // Size the table for the file up front so loading never rehashes
+    size_t line_count = 0;
+    for (int c; (c = fgetc(file)) != EOF;) {
+        line_count += (c == '\n');
+    }
+    rewind(file);
+
+    config_store.filename = filename;
+    config_store.slot_count = 16;
+    while (config_store.slot_count < (line_count + 1) * 4) {
+        config_store.slot_count *= 2;
+    }
+    config_store.slots = calloc(config_store.slot_count, sizeof(struct config_slot));
 
-        if (key && value) {
-            strncpy(config[config_size].key, trim_whitespace(key), sizeof(config[config_size].key) - 1);
-            strncpy(config[config_size].value, trim_whitespace(value), sizeof(config[config_size].value) - 1);
-            config[config_size].key[sizeof(config[config_size].key) - 1] = '\0'; // Ensure null-termination
-            config[config_size].value[sizeof(config[config_size].value) - 1] = '\0'; // Ensure null-termination
+    char* line = NULL;
+    size_t line_capacity = 0;
+    char* section = NULL;
+    int line_number = 0;
 
-            config_size++;
+    // Keys and section names are case-insensitive, as in Python's configparser
+    while (getline(&line, &line_capacity, file) != -1) {
+        line_number++;
+        char* text = trim_whitespace(line);
+        if (*text == '\0' || *text == '#' || *text == ';') {
+            continue;
+        }
+
+        if (*text == '[') {
+            char* close = strchr(text, ']');
+            if (!close || close[1] != '\0') {
+                fprintf(stderr, "%s:%d: malformed section header '%s'\n", filename, line_number, text);
+                exit(1);
+            }
+            *close = '\0';
+            free(section);
+            section = strdup(config_lowercase(trim_whitespace(text + 1)));
+            continue;
+        }
+
+        size_t key_length = strcspn(text, "=:");
+        if (text[key_length] == '\0') {
+            fprintf(stderr, "%s:%d: expected 'key = value' or '[section]', got '%s'\n", filename, line_number, text);
+            exit(1);
+        }
+        text[key_length] = '\0';
+        char* key = config_lowercase(trim_whitespace(text));
+        char* value = trim_whitespace(text + key_length + 1);
+        if (*key == '\0') {
+            fprintf(stderr, "%s:%d: missing key before '='\n", filename, line_number);
+            exit(1);
         }
-    }
 
+        config_add(section, key, value, line_number);
+    }
+    free(line);
+    free(section);
     fclose(file);
+
+    // An environment variable named after the key takes precedence, so that concurrent
+    // runs can select their configuration without rewriting config.ini
+    for (int i = 0; i < config_store.entry_count; ++i) {
+        struct config_entry* entry = config_store.entries[i];
+        char env_key[256];
+        const char* env_value = config_getenv(entry->key, env_key, sizeof(env_key));
+        if (env_value) {
+            config_report_override(entry->key, env_key, env_value);
+            free(entry->value);
+            entry->value = strdup(env_value);
+            entry->from_env = 1;
+        }
+    }
 }
 
-char* get_config_string(const char* key) {
-    for (int i = 0; i < config_size; i++) {
-        if (strcmp(config[i].key, key) == 0) {
-            return strdup(config[i].value);
+void free_config() {
+    for (int i = 0; i < config_store.entry_count; ++i) {
+        struct config_entry* entry = config_store.entries[i];
+        free(entry->section);
+        free(entry->key);
+        free(entry->qualified_key);
+        free(entry->value);
+        free(entry);
+    }
+    free(config_store.entries);
+    free(config_store.slots);
+    memset(&config_store, 0, sizeof(config_store));
+}
+
+// Warns about keys in config.ini that nothing looked up, which are usually misspelled
+void config_report_unused() {
+    for (int i = 0; i < config_store.entry_count; ++i) {
+        struct config_entry* entry = config_store.entries[i];
+        if (entry->line > 0 && !entry->used) {
+            fprintf(stderr, "Warning: %s:%d: unknown config key '%s'\n",
+                    config_store.filename, entry->line, entry->qualified_key ? entry->qualified_key : entry->key);
+        }
+    }
+}
+
+// Looks up a key, given bare or as "section.key". Keys missing from config.ini may still be
+// set in the environment; those are added to the store on first lookup, so look them up
+// before starting worker threads.
+struct config_entry* config_find(const char* key) {
+    struct config_slot* slot = config_lookup(key, config_hash(key));
+    struct config_entry* entry = slot->entry;
+    if (!entry) {
+        char env_key[256];
+        const char* env_value = config_getenv(key, env_key, sizeof(env_key));
+        if (!env_value) {
+            return NULL;
+        }
+        config_report_override(key, env_key, env_value);
+        entry = config_add(NULL, key, env_value, 0);
+        entry->from_env = 1;
+    }
+    entry->used = 1;
+    return entry;
+}
+
+// Reports a value that does not parse as expected and exits
+static void config_invalid(const struct config_entry* entry, const char* expected) {
+    if (entry->from_env) {
+        fprintf(stderr, "Environment override for '%s' is '%s', expected %s\n", entry->key, entry->value, expected);
+    } else {
+        fprintf(stderr, "%s:%d: '%s' is '%s', expected %s\n",
+                config_store.filename, entry->line, entry->key, entry->value, expected);
+    }
+    exit(1);
+}
+
+int64_t config_entry_int64(struct config_entry* entry) {
+    if (!(entry->parsed & CONFIG_PARSED_INT64)) {
+        char* end;
+        errno = 0;
+        long long value = strtoll(entry->value, &end, 0);
+        if (end == entry->value || *end != '\0' || errno == ERANGE) {
+            config_invalid(entry, "a 64-bit integer");
+        }
+        entry->int64_value = value;
+        entry->parsed |= CONFIG_PARSED_INT64;
+    }
+    return entry->int64_value;
+}
+
+double config_entry_double(struct config_entry* entry) {
+    if (!(entry->parsed & CONFIG_PARSED_DOUBLE)) {
+        char* end;
+        errno = 0;
+        double value = strtod(entry->value, &end);
+        if (end == entry->value || *end != '\0' || errno == ERANGE) {
+            config_invalid(entry, "a number");
+        }
+        entry->double_value = value;
+        entry->parsed |= CONFIG_PARSED_DOUBLE;
+    }
+    return entry->double_value;
+}
+
+// Sizes are byte counts with an optional binary suffix: 512, 32K, 4KiB, 2MB, 1G, 1T
+uint64_t config_entry_size(struct config_entry* entry) {
+    if (!(entry->parsed & CONFIG_PARSED_SIZE)) {
+        const char* p = entry->value;
+        if (!isdigit((unsigned char)*p)) {
+            config_invalid(entry, "a size such as 4096, 32K or 2M");
+        }
+
+        char* end;
+        errno = 0;
+        unsigned long long value = strtoull(p, &end, 10);
+        int shift = 0;
+        switch (toupper((unsigned char)*end)) {
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        case 'T': shift = 40; end++; break;
+        default: break;
+        }
+        if (shift && *end == 'i') end++;
+        if (toupper((unsigned char)*end) == 'B') end++;
+
+        if (*end != '\0' || errno == ERANGE || value > (UINT64_MAX >> shift)) {
+            config_invalid(entry, "a size such as 4096, 32K or 2M");
         }
+        entry->size_value = (uint64_t)value << shift;
+        entry->parsed |= CONFIG_PARSED_SIZE;
+    }
+    return entry->size_value;
+}
+
+// Accepts the same spellings as Python's configparser
+int config_entry_bool(struct config_entry* entry) {
+    static const char* true_values[] = { "1", "yes", "true", "on" };
+    static const char* false_values[] = { "0", "no", "false", "off" };
+    for (int i = 0; i < 4; ++i) {
+        if (strcasecmp(entry->value, true_values[i]) == 0) return 1;
+        if (strcasecmp(entry->value, false_values[i]) == 0) return 0;
     }
-    return NULL; // Key not found
+    config_invalid(entry, "true or false");
+    return 0;
+}
+
+char* get_config_string(const char* key) {
+    struct config_entry* entry = config_find(key);
+    return entry ? strdup(entry->value) : NULL; // NULL if the key is not found
 }
 
 int get_config_int(const char* key) {
-    char* val_str = get_config_string(key);
-    if (val_str) {
-        int val = atoi(val_str);
-        free(val_str);
-        return val;
+    return (int)get_config_int64(key, 0, INT_MIN, INT_MAX);
+}
+
+// Returns default_value if the key is not set, and exits if the value is outside [min, max]
+int64_t get_config_int64(const char* key, int64_t default_value, int64_t min, int64_t max) {
+    struct config_entry* entry = config_find(key);
+    if (!entry) {
+        return default_value;
     }
-    return 0; // Key not found or conversion error
+
+    int64_t value = config_entry_int64(entry);
+    if (value < min || value > max) {
+        char expected[96];
+        snprintf(expected, sizeof(expected), "an integer in [%lld, %lld]", (long long)min, (long long)max);
+        config_invalid(entry, expected);
+    }
+    return value;
+}
+
+uint64_t get_config_size(const char* key, uint64_t default_value) {
+    struct config_entry* entry = config_find(key);
+    return entry ? config_entry_size(entry) : default_value;
+}
+
+double get_config_double(const char* key) {
+    struct config_entry* entry = config_find(key);
+    return entry ? config_entry_double(entry) : 0.0;
 }
 
 int get_config_bool(const char* key) {
-    char* val_str = get_config_string(key);
-    if (val_str) {
-        int val = (strcmp(val_str, "true") == 0 || strcmp(val_str, "1") == 0);
-        free(val_str);
-        return val;
+    struct config_entry* entry = config_find(key);
+    return entry ? config_entry_bool(entry) : 0;
+}
+
+// Returns the index of the value in the NULL-terminated choices, or default_index if the key is not set
+int get_config_choice(const char* key, const char* const* choices, int default_index) {
+    struct config_entry* entry = config_find(key);
+    if (!entry) {
+        return default_index;
     }
-    return 0; // Key not found or conversion error
+
+    char expected[256] = "one of";
+    for (int i = 0; choices[i]; ++i) {
+        if (strcmp(entry->value, choices[i]) == 0) {
+            return i;
+        }
+        size_t length = strlen(expected);
+        snprintf(expected + length, sizeof(expected) - length, "%s '%s'", i ? "," : "", choices[i]);
+    }
+    config_invalid(entry, expected);
+    return default_index;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-truncation="
-FILE* create_data_output_file(const char* filename) {
-    char exe_path[PATH_MAX];
-    ssize_t length = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
-    if (length == -1) {
-        perror("readlink");
+// Splits a comma-separated value into trimmed, non-empty items. Returns NULL with
+// *count = 0 if the key is not set; free the result with free_config_list().
+char** get_config_list(const char* key, int* count) {
+    *count = 0;
+    struct config_entry* entry = config_find(key);
+    if (!entry) {
         return NULL;
     }
-    exe_path[length] = '\0';
 
+    int capacity = 1;
+    for (const char* p = entry->value; *p; ++p) {
+        capacity += (*p == ',');
+    }
+
+    char** list = malloc(sizeof(char*) * capacity);
+    char* copy = strdup(entry->value);
+    char* saveptr = NULL;
+    for (char* item = strtok_r(copy, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        item = trim_whitespace(item);
+        if (*item != '\0') {
+            list[(*count)++] = strdup(item);
+        }
+    }
+    free(copy);
+    return list;
+}
+
+void free_config_list(char** list, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(list[i]);
+    }
+    free(list);
+}
+
+// Parses a CPU list such as "0-3,8,10-11" into cpus, returning the number of CPUs found
+int parse_cpu_list(const char* list, int* cpus, int max_cpus) {
+    int count = 0;
+    const char* p = list;
+
+    while (*p && count < max_cpus) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            p++; // Skip separators and whitespace
+            continue;
+        }
+
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+
+        for (long cpu = first; cpu <= last && count < max_cpus; ++cpu) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                cpus[count++] = (int)cpu;
+            }
+        }
+        p = end;
+    }
+
+    return count;
+}
+
+#define ISOLATE_FIFO_PRIORITY 1    // The lowest real-time priority already preempts every normal task
+
+// Keeps every page of the benchmark resident and schedules it ahead of normal tasks. Workers
+// created later inherit the policy. Each step is optional, failures only produce warnings.
+// Returns whether the process now runs SCHED_FIFO.
+int isolate_process() {
+    char summary[128] = "";
+
+    // Future mappings can only be locked without limit, otherwise large sample buffers would fail to map
+    struct rlimit limit;
+    int lock_future = geteuid() == 0 || (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY);
+    if (mlockall(MCL_CURRENT | (lock_future ? MCL_FUTURE : 0)) == 0) {
+        strcat(summary, lock_future ? "memory locked" : "current memory locked");
+    } else {
+        fprintf(stderr, "Warning: mlockall failed: %s\n", strerror(errno));
+        strcat(summary, "memory not locked");
+    }
+
+    struct sched_param param = { .sched_priority = ISOLATE_FIFO_PRIORITY };
+    int fifo = sched_setscheduler(0, SCHED_FIFO, &param) == 0;
+    if (fifo) {
+        strcat(summary, ", SCHED_FIFO");
+    } else {
+        fprintf(stderr, "Warning: SCHED_FIFO not permitted: %s\n", strerror(errno));
+        strcat(summary, ", default scheduling");
+    }
+
+    printf("Isolation           : %s\n", summary);
+    return fifo;
+}
+
+// Reads the sizes in bytes of the data and unified caches of cpu from sysfs, one per level
+int read_cache_sizes(int cpu, size_t* sizes, int max_sizes) {
+    int count = 0;
+    for (int index = 0; count < max_sizes; ++index) {
+        char path[128];
+        char type[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+        FILE* file = fopen(path, "r");
+        if (!file) {
+            break;
+        }
+        int found = fscanf(file, "%31s", type) == 1;
+        fclose(file);
+        if (!found || strcmp(type, "Instruction") == 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, index);
+        file = fopen(path, "r");
+        if (!file) {
+            continue;
+        }
+        unsigned long long size;
+        char unit = '\0';
+        if (fscanf(file, "%llu%c", &size, &unit) >= 1) {
+            if (unit == 'K') size <<= 10;
+            else if (unit == 'M') size <<= 20;
+            else if (unit == 'G') size <<= 30;
+            sizes[count++] = (size_t)size;
+        }
+        fclose(file);
+    }
+    return count;
+}
+
+static int compare_sizes(const void* a, const void* b) {
+    size_t x = *(const size_t*)a;
+    size_t y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+#define WORK_SIZE_MAX_POINTS (1 << 20)
+
+static void push_work_size(size_t** sizes, int* count, size_t value) {
+    if (*count == WORK_SIZE_MAX_POINTS) {
+        fprintf(stderr, "The work-size sweep has more than %d points, use a geometric sweep or a larger step.\n", WORK_SIZE_MAX_POINTS);
+        exit(1);
+    }
+    // Capacity doubles whenever count reaches a power of two from 16 on
+    if (*count == 0 || (*count >= 16 && (*count & (*count - 1)) == 0)) {
+        *sizes = realloc(*sizes, sizeof(size_t) * (*count ? *count * 2 : 16));
+    }
+    (*sizes)[(*count)++] = value;
+}
+
+// Adds min, min * factor, min * factor^2, ... up to max, and max itself
+static void push_geometric_work_sizes(size_t** sizes, int* count, size_t min, size_t max, double factor) {
+    if (min > max) {
+        return;
+    }
+    // Each point is computed from min directly so rounding errors do not accumulate
+    for (int k = 0;; ++k) {
+        double value = (double)min * pow(factor, k);
+        if (value > (double)max) {
+            break;
+        }
+        push_work_size(sizes, count, (size_t)(value + 0.5));
+    }
+    push_work_size(sizes, count, max);
+}
+
+// Expands experiment_work_sweep into ascending, distinct work sizes:
+//   linear     min, min + step, ... up to max
+//   geometric  min, min * factor, ... up to max, e.g. factor 2 or 1.414 for two points per octave
+//   list       exactly the sizes in experiment_work_sizes
+//   cache      one point per doubling from min to max, plus points at 3/4, 7/8, 1, 9/8 and 3/2
+//              of every data cache level so that each transition is resolved. Sizes are bytes.
+int build_work_sizes(size_t** sizes) {
+    struct config_entry* sweep = config_find("experiment_work_sweep");
+    struct config_entry* factor_entry = config_find("experiment_work_size_factor");
+    struct config_entry* list_entry = config_find("experiment_work_sizes");
+    const char* mode = sweep && sweep->value[0] ? sweep->value : "linear";
+    double factor = factor_entry ? config_entry_double(factor_entry) : 2.0;
+    size_t min = EXPERIMENT_WORK_MIN_SIZE;
+    size_t max = EXPERIMENT_WORK_MAX_SIZE;
+    int count = 0;
+    *sizes = NULL;
+
+    if (strcmp(mode, "linear") == 0) {
+        if (EXPERIMENT_WORK_SIZE_STEP == 0) {
+            fprintf(stderr, "experiment_work_size_step must be at least 1.\n");
+            exit(1);
+        }
+        for (size_t value = min; value <= max; value += EXPERIMENT_WORK_SIZE_STEP) {
+            push_work_size(sizes, &count, value);
+            if (max - value < EXPERIMENT_WORK_SIZE_STEP) {
+                break; // The next step would pass max, or wrap around
+            }
+        }
+    } else if (strcmp(mode, "geometric") == 0 || strcmp(mode, "cache") == 0) {
+        if (factor_entry && factor <= 1.0) {
+            config_invalid(factor_entry, "a growth factor greater than 1");
+        }
+        if (min == 0) {
+            fprintf(stderr, "A %s sweep needs experiment_work_min_size of at least 1.\n", mode);
+            exit(1);
+        }
+
+        if (strcmp(mode, "geometric") == 0) {
+            push_geometric_work_sizes(sizes, &count, min, max, factor);
+        } else {
+            size_t caches[8];
+            int cache_count = read_cache_sizes(worker_cpus[0], caches, 8);
+            if (cache_count == 0) {
+                fprintf(stderr, "Warning: cache sizes of CPU %d are unavailable, sweeping by doubling only.\n", worker_cpus[0]);
+            }
+
+            push_geometric_work_sizes(sizes, &count, min, max, 2.0);
+            static const double boundary_points[] = { 0.75, 0.875, 1.0, 1.125, 1.5 };
+            for (int c = 0; c < cache_count; ++c) {
+                for (size_t i = 0; i < sizeof(boundary_points) / sizeof(boundary_points[0]); ++i) {
+                    size_t value = (size_t)(caches[c] * boundary_points[i]);
+                    if (value >= min && value <= max) {
+                        push_work_size(sizes, &count, value);
+                    }
+                }
+            }
+        }
+    } else if (strcmp(mode, "list") == 0) {
+        int item_count = 0;
+        char** items = get_config_list("experiment_work_sizes", &item_count);
+        for (int i = 0; i < item_count; ++i) {
+            // Parse each item as its own entry so errors point at the list
+            struct config_entry item = *list_entry;
+            item.value = items[i];
+            item.parsed = 0;
+            push_work_size(sizes, &count, config_entry_size(&item));
+        }
+        free_config_list(items, item_count);
+    } else {
+        config_invalid(sweep, "linear, geometric, list or cache");
+    }
+
+    qsort(*sizes, count, sizeof(size_t), compare_sizes);
+    int unique = 0;
+    for (int i = 0; i < count; ++i) {
+        if (unique == 0 || (*sizes)[i] != (*sizes)[unique - 1]) {
+            (*sizes)[unique++] = (*sizes)[i];
+        }
+    }
+
+    if (unique == 0) {
+        fprintf(stderr, "The %s work-size sweep is empty, check the experiment_work_* settings.\n", mode);
+        exit(1);
+    }
+    return unique;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation="
+FILE* create_data_output_file(const char* filename) {
     // Construct the initial part of the path to the data directory
-    char* dir = dirname(exe_path); // Get directory of the executable
     char data_dir_path[PATH_MAX];
-    snprintf(data_dir_path, sizeof(data_dir_path), "%s/../data/raw/run_%d/%s",
-             dir, EXPERIMENT_RUN_ID,
+    snprintf(data_dir_path, sizeof(data_dir_path), "%s/data/raw/run_%d/%s",
+             EXPERIMENT_ROOT, EXPERIMENT_RUN_ID,
              EXPERIMENT_CONFIGURATION_NAME ? EXPERIMENT_CONFIGURATION_NAME : "default");
 
     // Tokenize the path and create directories one by one
@@ -9,7 +9,8 @@ logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(
 
 def convert_latency(df, target_unit):
     """
-    Converts the latency values in the DataFrame to the specified unit.
+    Converts the latency values in the DataFrame to the specified unit. Batched latency
+    measurements record picoseconds per call in a 'latency_ps' column, which becomes 'latency'.
 
     Parameters:
         df (pandas.DataFrame): The DataFrame with latency values.
@@ -26,6 +27,10 @@ def convert_latency(df, target_unit):
         's': 1e9,   # Nanoseconds to seconds
     }
 
+    if 'latency_ps' in df.columns:
+        df = df.rename(columns={'latency_ps': 'latency'})
+        df['latency'] = df['latency'] / 1e3
+
     if target_unit in conversion_factors:
         conversion_factor = conversion_factors[target_unit]
         df['latency'] = df['latency'] / conversion_factor
@@ -63,6 +68,157 @@ def load_data(file_path, config):
         logging.error(f"Failed to load data: {e}")
         sys.exit(1)
 
+def load_histogram(file_path, config):
+    """
+    Loads a binary latency histogram dump (latency_histogram.bin) into a DataFrame of bucket counts.
+
+    Parameters:
+        file_path (str): The path to the histogram file.
+        config: Dictionary of config variables and flags.
+
+    Returns:
+        pandas.DataFrame: One row per non-empty bucket with 'threads', 'thread_id', 'work_size', 'latency' and 'count' columns.
+    """
+    header_dtype = np.dtype([
+        ('threads', '<u4'), ('thread_id', '<u4'),
+        ('work_size', '<u8'), ('total_count', '<u8'), ('min', '<u8'), ('max', '<u8'),
+        ('significant_digits', '<u4'), ('sub_bucket_half_count_magnitude', '<u4'),
+        ('bucket_count', '<u4'), ('nonzero_count', '<u4'),
+    ])
+
+    try:
+        with open(file_path, 'rb') as f:
+            data = f.read()
+
+        # Histograms of batched latency measurements hold picoseconds per call
+        if data[:8] not in (b'APXHIST1', b'APXHISTP'):
+            raise ValueError("not an archiplex histogram file")
+        latency_scale = 1e3 if data[:8] == b'APXHISTP' else 1
+
+        frames = []
+        offset = 8
+        while offset < len(data):
+            header = np.frombuffer(data, dtype=header_dtype, count=1, offset=offset)[0]
+            offset += header_dtype.itemsize
+            n = int(header['nonzero_count'])
+            indices = np.frombuffer(data, dtype='<u4', count=n, offset=offset).astype(np.int64)
+            offset += 4 * n
+            counts = np.frombuffer(data, dtype='<u8', count=n, offset=offset)
+            offset += 8 * n
+
+            # Map each bucket index back to the highest value it represents
+            magnitude = int(header['sub_bucket_half_count_magnitude'])
+            half_count = 1 << magnitude
+            bucket_index = (indices >> magnitude) - 1
+            sub_bucket_index = (indices & (half_count - 1)) + half_count
+            first_bucket = bucket_index < 0
+            sub_bucket_index[first_bucket] -= half_count
+            bucket_index[first_bucket] = 0
+            values = (sub_bucket_index << bucket_index) + (1 << bucket_index) - 1
+
+            frames.append(pd.DataFrame({
+                'threads': int(header['threads']),
+                'thread_id': int(header['thread_id']),
+                'work_size': int(header['work_size']),
+                'latency': np.minimum(values, int(header['max'])) / latency_scale,
+                'count': counts,
+            }))
+
+        df = pd.concat(frames, ignore_index=True)
+        df = convert_latency(df, config["latency_unit"])
+        df['configuration'] = os.path.basename(os.path.dirname(file_path))
+
+        logging.info("Histogram loaded successfully.")
+        return df
+    except Exception as e:
+        logging.error(f"Failed to load histogram: {e}")
+        sys.exit(1)
+
+COLUMNAR_TYPES = {1: np.dtype('<u4'), 2: np.dtype('<u8'), 3: np.dtype('<f8')}
+COLUMNAR_RLE = 1
+
+def load_columnar(file_path):
+    """
+    Opens a binary columnar result file (e.g. latencies.bin) without reading its data.
+
+    Plain columns are returned as read-only numpy memmaps, so only the pages that are
+    actually accessed get loaded. Run-length encoded columns such as 'work_size' are
+    returned as structured arrays of ('value', 'count') runs.
+
+    Parameters:
+        file_path (str): The path to the binary result file.
+
+    Returns:
+        dict: Column name to numpy array, plus 'row_count'.
+    """
+    header_dtype = np.dtype([
+        ('magic', 'S8'), ('version', '<u4'), ('column_count', '<u4'), ('row_count', '<u8'), ('reserved', 'V40'),
+    ])
+    column_dtype = np.dtype([
+        ('name', 'S32'), ('type', '<u4'), ('encoding', '<u4'), ('offset', '<u8'), ('length', '<u8'), ('reserved', '<u8'),
+    ])
+    run_dtype = np.dtype([('value', '<u8'), ('count', '<u8')])
+
+    try:
+        header = np.fromfile(file_path, dtype=header_dtype, count=1)[0]
+        if header['magic'] != b'APXCOL01':
+            raise ValueError("not an archiplex columnar file")
+
+        columns = np.fromfile(file_path, dtype=column_dtype, count=int(header['column_count']), offset=header_dtype.itemsize)
+        data = {'row_count': int(header['row_count'])}
+        for column in columns:
+            name = column['name'].decode()
+            length = int(column['length'])
+            if column['encoding'] == COLUMNAR_RLE:
+                data[name] = np.fromfile(file_path, dtype=run_dtype, count=length, offset=int(column['offset']))
+            elif length > 0:
+                data[name] = np.memmap(file_path, dtype=COLUMNAR_TYPES[int(column['type'])], mode='r',
+                                       offset=int(column['offset']), shape=(length,))
+            else:
+                data[name] = np.empty(0, dtype=COLUMNAR_TYPES[int(column['type'])])
+
+        logging.info(f"Columnar data opened: {data['row_count']} rows.")
+        return data
+    except Exception as e:
+        logging.error(f"Failed to open columnar data: {e}")
+        sys.exit(1)
+
+def columnar_runs(runs):
+    """
+    Yields (value, slice) for every run of a run-length encoded column, so that plain
+    columns can be sliced per run without copying, e.g. data['latency'][rows].
+
+    Parameters:
+        runs (numpy.ndarray): A run-length encoded column returned by load_columnar.
+    """
+    start = 0
+    for value, count in zip(runs['value'], runs['count']):
+        yield int(value), slice(start, start + int(count))
+        start += int(count)
+
+def columnar_to_dataframe(data, config, rows=slice(None)):
+    """
+    Materializes a range of rows of a columnar result file as a DataFrame.
+
+    Parameters:
+        data (dict): Columns returned by load_columnar.
+        config: Dictionary of config variables and flags.
+        rows (slice): The rows to load, all of them by default.
+
+    Returns:
+        pandas.DataFrame: The selected rows with run-length encoded columns expanded.
+    """
+    columns = {}
+    for name, values in data.items():
+        if name == 'row_count':
+            continue
+        if values.dtype.names == ('value', 'count'):
+            values = np.repeat(values['value'], values['count'].astype(np.int64))
+        columns[name] = np.asarray(values[rows])
+
+    df = convert_latency(pd.DataFrame(columns), config["latency_unit"])
+    return df
+
 def remove_outliers(df, column_name):
     """
     Removes outliers from a specific column in the DataFrame based on the IQR method.
@@ -87,6 +243,33 @@ def remove_outliers(df, column_name):
     logging.info(f"Outliers removed from column '{column_name}'.")
     return filtered_df
 
+def summarize_latency(df, keys):
+    """
+    Computes the mean and standard deviation of the latency per group. Rows are weighted by
+    their 'count' column when there is one, so histogram buckets and raw samples both work.
+
+    Parameters:
+        df (pandas.DataFrame): Latencies from load_histogram, process_data or columnar_to_dataframe.
+        keys (list): The columns to group by, e.g. ['configuration', 'work_size'].
+
+    Returns:
+        pandas.DataFrame: One row per group with 'latency_mean' and 'latency_std' columns.
+    """
+    weights = df['count'] if 'count' in df.columns else pd.Series(1, index=df.index)
+    df = df.assign(weight=weights, weighted=df['latency'] * weights)
+
+    groups = df.groupby(keys)
+    summary = groups[['weight', 'weighted']].sum()
+    summary['latency_mean'] = summary['weighted'] / summary['weight']
+
+    # Sample variance with the group mean broadcast back to every row
+    mean = df[keys].merge(summary['latency_mean'].reset_index(), on=keys, how='left')['latency_mean'].to_numpy()
+    df = df.assign(squares=df['weight'] * (df['latency'] - mean) ** 2)
+    squares = df.groupby(keys)['squares'].sum()
+    summary['latency_std'] = np.sqrt(squares / (summary['weight'] - 1).clip(lower=1))
+
+    return summary[['latency_mean', 'latency_std']].reset_index()
+
 def process_data(file_path, config):
     """
     Main function to process the data based on the provided configuration.
@@ -0,0 +1,77 @@
+// Atomic read-modify-write throughput on one shared counter. Every call updates the counter,
+// then spends work_size iterations of think time (benchmark_delay): 0 keeps the counter's cache
+// line permanently contended, larger work sizes spread the updates out. The configuration name
+// picks the update:
+//   fetch_add  a single atomic add, which always succeeds
+//   cas        a load followed by a compare-and-swap loop, which retries whenever another
+//              worker changed the counter in between
+// The retries of the cas loop are counted and printed at the end. Compare the two across a thread
+// sweep for the cost of contention, and thread_throughput.csv for how evenly the line is shared.
+#if !defined(CONFIG_FETCH_ADD) && !defined(CONFIG_CAS)
+#define CONFIG_FETCH_ADD // Configurations with other names measure fetch_add
+#endif
+
+struct atomics_worker {
+    uint64_t           updates;
+    uint64_t           retries;
+};
+
+static _Atomic uint64_t*    atomics_counter = NULL;
+static atomic_uint_fast64_t atomics_updates = 0;
+static atomic_uint_fast64_t atomics_retries = 0;
+
+void setup() {
+    // Two lines, so that adjacent-line prefetching does not pull in anything else
+    atomics_counter = workload_alloc(2 * CACHE_LINE_SIZE, 2 * CACHE_LINE_SIZE,
+                                     WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!atomics_counter) {
+        fprintf(stderr, "Failed to allocate the shared counter: %s\n", strerror(errno));
+        exit(1);
+    }
+    atomic_store(atomics_counter, 0);
+}
+
+void cleanup() {
+    uint64_t updates = atomic_load(&atomics_updates);
+    uint64_t counted = atomic_load(atomics_counter);
+    if (counted != updates) {
+        fprintf(stderr, "Error: the shared counter reads %lu after %lu atomic updates.\n", counted, updates);
+    }
+#ifdef CONFIG_CAS
+    uint64_t retries = atomic_load(&atomics_retries);
+    printf("Compare-and-swap retries: %lu (%.3f per update)\n", retries, updates ? (double)retries / updates : 0.0);
+#endif
+    workload_free((void*)atomics_counter);
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    if (!context->user) {
+        context->user = calloc(1, sizeof(struct atomics_worker));
+    }
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        struct atomics_worker* worker = context->user;
+        atomic_fetch_add(&atomics_updates, worker->updates);
+        atomic_fetch_add(&atomics_retries, worker->retries);
+        free(worker);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct atomics_worker* worker = context->user;
+#ifdef CONFIG_CAS
+    uint64_t value = atomic_load_explicit(atomics_counter, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(atomics_counter, &value, value + 1,
+                                                  memory_order_acq_rel, memory_order_relaxed)) {
+        worker->retries++;
+    }
+#else
+    atomic_fetch_add_explicit(atomics_counter, 1, memory_order_acq_rel);
+#endif
+    worker->updates++;
+    benchmark_delay(context->work_size);
+}
@@ -0,0 +1,194 @@
+// Read and write bandwidth over a work_size byte buffer. Every call accesses BANDWIDTH_CALL_BYTES
+// of the buffer with the vector width of the configuration, continuing where the previous call
+// stopped and wrapping at the end, so experiment_bytes_per_op = 4096 turns the throughput into
+// bytes per second at every work size. The kernel is picked by the configuration name:
+//   scalar  64-bit loads and stores           sse2    128-bit (x86)
+//   avx2    256-bit (x86)                     avx512  512-bit (x86, AVX-512F)
+//   neon    128-bit (aarch64)
+// The [Workload] section of config.ini selects the access pattern:
+//   workload_access  read or write
+//   workload_stride  bytes from one access to the next, 0 for sequential. Strides beyond a cache
+//                    line still count only the accessed bytes, so they show how much of the
+//                    transferred data a strided access pattern actually uses.
+#define BANDWIDTH_CALL_BYTES 4096
+#define BANDWIDTH_UNROLL     4
+
+#if defined(CONFIG_AVX512) || defined(CONFIG_AVX2) || defined(CONFIG_SSE2)
+#include <immintrin.h>
+#elif defined(CONFIG_NEON)
+#include <arm_neon.h>
+#endif
+
+// The kernels are compiled for their instruction set with the target attribute, so the rest of
+// the benchmark keeps the baseline flags and a missing extension is reported instead of crashing
+#if defined(CONFIG_AVX512)
+#define BANDWIDTH_ISA          "avx512f"
+#define BANDWIDTH_TARGET       __attribute__((target("avx512f"), noinline))
+#define bandwidth_vector       __m512i
+#define bandwidth_set(x)       _mm512_set1_epi64((long long)(x))
+#define bandwidth_load(p)      _mm512_load_si512((const void*)(p))
+#define bandwidth_store(p, v)  _mm512_store_si512((void*)(p), v)
+#define bandwidth_or(a, b)     _mm512_or_si512(a, b)
+#elif defined(CONFIG_AVX2)
+#define BANDWIDTH_ISA          "avx2"
+#define BANDWIDTH_TARGET       __attribute__((target("avx2"), noinline))
+#define bandwidth_vector       __m256i
+#define bandwidth_set(x)       _mm256_set1_epi64x((long long)(x))
+#define bandwidth_load(p)      _mm256_load_si256((const __m256i*)(p))
+#define bandwidth_store(p, v)  _mm256_store_si256((__m256i*)(p), v)
+#define bandwidth_or(a, b)     _mm256_or_si256(a, b)
+#elif defined(CONFIG_SSE2)
+#define BANDWIDTH_ISA          "sse2"
+#define BANDWIDTH_TARGET       __attribute__((target("sse2"), noinline))
+#define bandwidth_vector       __m128i
+#define bandwidth_set(x)       _mm_set1_epi64x((long long)(x))
+#define bandwidth_load(p)      _mm_load_si128((const __m128i*)(p))
+#define bandwidth_store(p, v)  _mm_store_si128((__m128i*)(p), v)
+#define bandwidth_or(a, b)     _mm_or_si128(a, b)
+#elif defined(CONFIG_NEON)
+#define BANDWIDTH_TARGET       __attribute__((noinline))
+#define bandwidth_vector       uint64x2_t
+#define bandwidth_set(x)       vdupq_n_u64((uint64_t)(x))
+#define bandwidth_load(p)      vld1q_u64((const uint64_t*)(p))
+#define bandwidth_store(p, v)  vst1q_u64((uint64_t*)(p), v)
+#define bandwidth_or(a, b)     vorrq_u64(a, b)
+#else
+#define BANDWIDTH_TARGET       __attribute__((noinline))
+#define bandwidth_vector       uint64_t
+#define bandwidth_set(x)       ((uint64_t)(x))
+#define bandwidth_load(p)      (*(const volatile uint64_t*)(p))
+#define bandwidth_store(p, v)  (*(volatile uint64_t*)(p) = (v))
+#define bandwidth_or(a, b)     ((a) | (b))
+#endif
+
+#define BANDWIDTH_VECTOR_BYTES sizeof(bandwidth_vector)
+
+#define BANDWIDTH_READ  0
+#define BANDWIDTH_WRITE 1
+
+struct bandwidth {
+    char*              buffer;
+    size_t             size;
+    size_t             offset;         // Where the next call continues
+};
+
+static int    bandwidth_access = BANDWIDTH_READ;
+static size_t bandwidth_stride = 0;
+static volatile uint64_t bandwidth_sink;
+
+// Reads count vectors stride bytes apart. Independent accumulators keep the loads from
+// waiting on each other.
+static BANDWIDTH_TARGET void bandwidth_read(const char* address, size_t stride, size_t count) {
+    bandwidth_vector sums[BANDWIDTH_UNROLL];
+    for (int u = 0; u < BANDWIDTH_UNROLL; ++u) {
+        sums[u] = bandwidth_set(0);
+    }
+    size_t i = 0;
+    for (; i + BANDWIDTH_UNROLL <= count; i += BANDWIDTH_UNROLL) {
+        for (int u = 0; u < BANDWIDTH_UNROLL; ++u) {
+            sums[u] = bandwidth_or(sums[u], bandwidth_load(address + u * stride));
+        }
+        address += BANDWIDTH_UNROLL * stride;
+    }
+    for (; i < count; ++i) {
+        sums[0] = bandwidth_or(sums[0], bandwidth_load(address));
+        address += stride;
+    }
+    for (int u = 1; u < BANDWIDTH_UNROLL; ++u) {
+        sums[0] = bandwidth_or(sums[0], sums[u]);
+    }
+
+    uint64_t lanes[BANDWIDTH_VECTOR_BYTES / sizeof(uint64_t)];
+    memcpy(lanes, &sums[0], sizeof(lanes));
+    bandwidth_sink = lanes[0];
+}
+
+static BANDWIDTH_TARGET void bandwidth_write(char* address, size_t stride, size_t count, uint64_t value) {
+    bandwidth_vector data = bandwidth_set(value);
+    for (size_t i = 0; i < count; ++i) {
+        bandwidth_store(address, data);
+        address += stride;
+    }
+}
+
+void setup() {
+#ifdef BANDWIDTH_ISA
+    if (!__builtin_cpu_supports(BANDWIDTH_ISA)) {
+        fprintf(stderr, "This CPU does not support %s, which configuration %s needs.\n", BANDWIDTH_ISA,
+                EXPERIMENT_CONFIGURATION_NAME ? EXPERIMENT_CONFIGURATION_NAME : "default");
+        exit(1);
+    }
+#endif
+
+    static const char* const accesses[] = { "read", "write", NULL };
+    bandwidth_access = get_config_choice("workload_access", accesses, BANDWIDTH_READ);
+    bandwidth_stride = get_config_size("workload_stride", 0);
+    if (bandwidth_stride == 0) {
+        bandwidth_stride = BANDWIDTH_VECTOR_BYTES;
+    }
+    if (bandwidth_stride % BANDWIDTH_VECTOR_BYTES != 0) {
+        fprintf(stderr, "workload_stride must be a multiple of the %zu byte vectors.\n", BANDWIDTH_VECTOR_BYTES);
+        exit(1);
+    }
+    if (EXPERIMENT_BYTES_PER_OP != BANDWIDTH_CALL_BYTES) {
+        fprintf(stderr, "Warning: each call accesses %d bytes, set experiment_bytes_per_op = %d to report bandwidth.\n",
+                BANDWIDTH_CALL_BYTES, BANDWIDTH_CALL_BYTES);
+    }
+}
+
+void cleanup() {
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    struct bandwidth* bandwidth = context->user;
+    if (!bandwidth) {
+        bandwidth = context->user = calloc(1, sizeof(struct bandwidth));
+    }
+
+    bandwidth->size = context->work_size / bandwidth_stride * bandwidth_stride;
+    if (bandwidth->size == 0) {
+        bandwidth->size = bandwidth_stride;
+    }
+    bandwidth->offset = 0;
+    bandwidth->buffer = workload_alloc(bandwidth->size, CACHE_LINE_SIZE, WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!bandwidth->buffer) {
+        fprintf(stderr, "Failed to allocate a %zu byte buffer: %s\n", bandwidth->size, strerror(errno));
+        exit(1);
+    }
+    memset(bandwidth->buffer, 1, bandwidth->size);
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    struct bandwidth* bandwidth = context->user;
+    workload_free(bandwidth->buffer);
+    bandwidth->buffer = NULL;
+
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        free(bandwidth);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct bandwidth* bandwidth = context->user;
+    size_t remaining = BANDWIDTH_CALL_BYTES / BANDWIDTH_VECTOR_BYTES;
+
+    // Buffers smaller than a call are accessed several times over
+    while (remaining > 0) {
+        size_t count = (bandwidth->size - bandwidth->offset) / bandwidth_stride;
+        if (count > remaining) {
+            count = remaining;
+        }
+        if (bandwidth_access == BANDWIDTH_READ) {
+            bandwidth_read(bandwidth->buffer + bandwidth->offset, bandwidth_stride, count);
+        } else {
+            bandwidth_write(bandwidth->buffer + bandwidth->offset, bandwidth_stride, count, context->iteration);
+        }
+        remaining -= count;
+        bandwidth->offset += count * bandwidth_stride;
+        if (bandwidth->offset >= bandwidth->size) {
+            bandwidth->offset = 0;
+        }
+    }
+}
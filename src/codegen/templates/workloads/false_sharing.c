@@ -0,0 +1,43 @@
+// False sharing. Every worker increments a counter of its own, and the work size is the distance
+// in bytes between the counters of neighbouring workers. Below the cache line size the counters
+// share lines and every increment has to take its line from another core, although no two
+// workers ever touch the same data; at 64 bytes each counter has a line to itself, and at 128
+// bytes adjacent-line prefetching no longer pairs them either. Sweep the threads and list the
+// distances, e.g. experiment_work_sizes = 8, 16, 32, 64, 128, 256.
+static char* false_sharing_counters = NULL;
+
+void setup() {
+    size_t max_distance = EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1];
+    int max_threads = EXPERIMENT_THREAD_MAX > 0 ? EXPERIMENT_THREAD_MAX : 1;
+    if (EXPERIMENT_WORK_SIZES[0] < sizeof(uint64_t)) {
+        fprintf(stderr, "Counters are %zu bytes, so the work sizes must be at least that.\n", sizeof(uint64_t));
+        exit(1);
+    }
+
+    // The first counter starts a line, so a distance below the line size always shares it
+    false_sharing_counters = workload_alloc(max_distance * max_threads, CACHE_LINE_SIZE,
+                                            WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!false_sharing_counters) {
+        fprintf(stderr, "Failed to allocate the counters: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+void cleanup() {
+    workload_free(false_sharing_counters);
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    size_t distance = context->work_size & ~(sizeof(uint64_t) - 1);
+    context->user = false_sharing_counters + (size_t)context->thread_id * distance;
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    (void)context;
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    // A plain increment, the counter belongs to this worker alone
+    volatile uint64_t* counter = context->user;
+    *counter = *counter + 1;
+}
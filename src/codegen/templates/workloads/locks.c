@@ -0,0 +1,163 @@
+// Lock comparison. Every call acquires a lock shared by all workers, runs a short critical
+// section on shared data and releases it, then spends work_size iterations of think time
+// (benchmark_delay) outside the lock: 0 is the highest contention, and larger work sizes let
+// the workers overlap more. The configuration name picks the lock:
+//   mutex   pthread_mutex_t                    spin    test-and-test-and-set spin lock
+//   ticket  FIFO ticket lock                   mcs     MCS queue lock, each waiter spins on its own line
+// The [Workload] section of config.ini sets the critical section:
+//   workload_critical_lines  shared cache lines written while holding the lock
+//   workload_critical_delay  additional delay iterations while holding the lock
+// Sweep the threads for scalability, and read fairness from thread_throughput.csv: a lock that
+// lets one worker reacquire it again and again finishes that worker long before the others.
+#if !defined(CONFIG_MUTEX) && !defined(CONFIG_SPIN) && !defined(CONFIG_TICKET) && !defined(CONFIG_MCS)
+#define CONFIG_MUTEX // Configurations with other names measure pthread_mutex_t
+#endif
+
+struct mcs_node {
+    _Atomic(struct mcs_node*) next;
+    atomic_int                locked;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+struct lock_worker {
+    struct mcs_node           node;           // The queue entry of an MCS waiter, unused by the other locks
+    uint64_t                  acquisitions;
+};
+
+// Every lock state starts a cache line of its own, away from the protected data
+struct shared_lock {
+#if defined(CONFIG_MUTEX)
+    pthread_mutex_t           mutex;
+#elif defined(CONFIG_SPIN)
+    atomic_int                locked;
+#elif defined(CONFIG_TICKET)
+    atomic_uint               next;
+    atomic_uint               serving;
+#elif defined(CONFIG_MCS)
+    _Atomic(struct mcs_node*) tail;
+#endif
+} __attribute__((aligned(2 * CACHE_LINE_SIZE)));
+
+static struct shared_lock lock_state;
+static char*              lock_data = NULL;
+static size_t             lock_critical_lines = 1;
+static uint64_t           lock_critical_delay = 0;
+static atomic_uint_fast64_t lock_acquisitions = 0;
+
+// Waiting workers yield now and then, so that workers sharing a CPU do not spin out their time slices
+#define LOCK_WAIT(condition)                                            \
+    for (unsigned spins = 1; (condition); ++spins) {                    \
+        cpu_relax();                                                    \
+        if (spins % 4096 == 0) {                                        \
+            sched_yield();                                              \
+        }                                                               \
+    }
+
+static inline __attribute__((always_inline)) void lock_acquire(struct mcs_node* node) {
+#if defined(CONFIG_MUTEX)
+    (void)node;
+    pthread_mutex_lock(&lock_state.mutex);
+#elif defined(CONFIG_SPIN)
+    (void)node;
+    while (atomic_exchange_explicit(&lock_state.locked, 1, memory_order_acquire)) {
+        LOCK_WAIT(atomic_load_explicit(&lock_state.locked, memory_order_relaxed));
+    }
+#elif defined(CONFIG_TICKET)
+    (void)node;
+    unsigned ticket = atomic_fetch_add_explicit(&lock_state.next, 1, memory_order_relaxed);
+    LOCK_WAIT(atomic_load_explicit(&lock_state.serving, memory_order_acquire) != ticket);
+#elif defined(CONFIG_MCS)
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->locked, 1, memory_order_relaxed);
+    struct mcs_node* previous = atomic_exchange_explicit(&lock_state.tail, node, memory_order_acq_rel);
+    if (previous) {
+        atomic_store_explicit(&previous->next, node, memory_order_release);
+        LOCK_WAIT(atomic_load_explicit(&node->locked, memory_order_acquire));
+    }
+#endif
+}
+
+static inline __attribute__((always_inline)) void lock_release(struct mcs_node* node) {
+#if defined(CONFIG_MUTEX)
+    (void)node;
+    pthread_mutex_unlock(&lock_state.mutex);
+#elif defined(CONFIG_SPIN)
+    (void)node;
+    atomic_store_explicit(&lock_state.locked, 0, memory_order_release);
+#elif defined(CONFIG_TICKET)
+    (void)node;
+    unsigned serving = atomic_load_explicit(&lock_state.serving, memory_order_relaxed);
+    atomic_store_explicit(&lock_state.serving, serving + 1, memory_order_release);
+#elif defined(CONFIG_MCS)
+    struct mcs_node* next = atomic_load_explicit(&node->next, memory_order_acquire);
+    if (!next) {
+        // No known successor: either the queue is empty, or one is between the exchange and the link
+        struct mcs_node* expected = node;
+        if (atomic_compare_exchange_strong_explicit(&lock_state.tail, &expected, NULL,
+                                                    memory_order_acq_rel, memory_order_relaxed)) {
+            return;
+        }
+        LOCK_WAIT(!(next = atomic_load_explicit(&node->next, memory_order_acquire)));
+    }
+    atomic_store_explicit(&next->locked, 0, memory_order_release);
+#endif
+}
+
+void setup() {
+#if defined(CONFIG_MUTEX)
+    pthread_mutex_init(&lock_state.mutex, NULL);
+#endif
+    lock_critical_lines = get_config_size("workload_critical_lines", 1);
+    lock_critical_delay = get_config_size("workload_critical_delay", 0);
+    if (lock_critical_lines == 0) {
+        lock_critical_lines = 1;
+    }
+    lock_data = workload_alloc(lock_critical_lines * CACHE_LINE_SIZE, CACHE_LINE_SIZE,
+                               WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!lock_data) {
+        fprintf(stderr, "Failed to allocate the shared data: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+void cleanup() {
+    // Every increment happened under the lock, so a lost one means the lock is broken
+    uint64_t expected = atomic_load(&lock_acquisitions);
+    uint64_t counted = *(uint64_t*)lock_data;
+    if (counted != expected) {
+        fprintf(stderr, "Error: the shared counter reads %lu after %lu increments made under the lock.\n", counted, expected);
+    }
+#if defined(CONFIG_MUTEX)
+    pthread_mutex_destroy(&lock_state.mutex);
+#endif
+    workload_free(lock_data);
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    if (!context->user) {
+        context->user = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct lock_worker));
+        memset(context->user, 0, sizeof(struct lock_worker));
+    }
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        struct lock_worker* worker = context->user;
+        atomic_fetch_add(&lock_acquisitions, worker->acquisitions);
+        free(worker);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct lock_worker* worker = context->user;
+    lock_acquire(&worker->node);
+    for (size_t line = 0; line < lock_critical_lines; ++line) {
+        uint64_t* value = (uint64_t*)(lock_data + line * CACHE_LINE_SIZE);
+        *value = *value + 1;
+    }
+    benchmark_delay(lock_critical_delay);
+    lock_release(&worker->node);
+    worker->acquisitions++;
+    benchmark_delay(context->work_size);
+}
@@ -0,0 +1,84 @@
+// Cache-line ping-pong between cores. Workers are paired (0 with 1, 2 with 3, ...) and every pair
+// shares a turn flag followed by work_size payload lines. On each call a worker waits for its
+// turn, writes every payload line and hands the turn over, so all lines migrate to the other
+// core and back once per two calls: the latency of a call is one one-way transfer. Place the
+// pair with experiment_thread_cpus, e.g. "0,1" for SMT siblings or two CPUs on different sockets.
+// Both workers of a pair must make the same number of calls, so warmup and loop calibration,
+// which run every worker on its own, are not supported.
+struct ping_pong {
+    _Atomic uint64_t*  turn;
+    char*              payload;
+    uint64_t           sequence;       // Number of handoffs of the pair so far, kept across work sizes
+    int                side;           // 0 for the even worker of the pair, 1 for the odd one
+};
+
+// Pairs are padded to 128 bytes so that adjacent-line prefetching never couples two pairs
+#define PING_PONG_PAIR_ALIGNMENT (2 * CACHE_LINE_SIZE)
+
+static char*  ping_pong_lines = NULL;
+static size_t ping_pong_pair_size = 0;
+
+void setup() {
+    if (EXPERIMENT_THREAD_MAX < 2 || EXPERIMENT_THREAD_MIN % 2 != 0 || EXPERIMENT_THREAD_STEP % 2 != 0) {
+        fprintf(stderr, "Ping-pong runs pairs of workers: set experiment_thread_min, _max and _step to even numbers.\n");
+        exit(1);
+    }
+    if (EXPERIMENT_WARMUP != WARMUP_OFF || EXPERIMENT_LOOP_CALIBRATION != LOOP_CALIBRATION_OFF) {
+        fprintf(stderr, "Ping-pong needs experiment_warmup and experiment_loop_calibration set to off.\n");
+        exit(1);
+    }
+
+    // Allocated once for the largest sweep point, so the turn flags survive from one size to the next
+    size_t max_lines = EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1];
+    ping_pong_pair_size = ((1 + max_lines) * CACHE_LINE_SIZE + PING_PONG_PAIR_ALIGNMENT - 1) & ~(size_t)(PING_PONG_PAIR_ALIGNMENT - 1);
+    ping_pong_lines = workload_alloc(ping_pong_pair_size * (EXPERIMENT_THREAD_MAX / 2), PING_PONG_PAIR_ALIGNMENT,
+                                     WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!ping_pong_lines) {
+        fprintf(stderr, "Failed to allocate the ping-pong lines: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+void cleanup() {
+    workload_free(ping_pong_lines);
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    struct ping_pong* pong = context->user;
+    if (!pong) {
+        // A new thread count starts with fresh workers, and with fresh turn flags
+        pong = context->user = calloc(1, sizeof(struct ping_pong));
+        char* pair = ping_pong_lines + (context->thread_id / 2) * ping_pong_pair_size;
+        pong->turn = (_Atomic uint64_t*)pair;
+        pong->payload = pair + CACHE_LINE_SIZE;
+        pong->side = context->thread_id % 2;
+        if (pong->side == 0) {
+            atomic_store(pong->turn, 0);
+        }
+    }
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        free(context->user);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct ping_pong* pong = context->user;
+    uint64_t turn = 2 * pong->sequence + pong->side;
+    // Yielding now and then keeps pairs that share a CPU from spinning out their time slices
+    for (unsigned spins = 1; atomic_load_explicit(pong->turn, memory_order_acquire) != turn; ++spins) {
+        cpu_relax();
+        if (spins % 4096 == 0) {
+            sched_yield();
+        }
+    }
+    for (size_t line = 0; line < context->work_size; ++line) {
+        *(volatile uint64_t*)(pong->payload + line * CACHE_LINE_SIZE) = turn;
+    }
+    atomic_store_explicit(pong->turn, turn + 1, memory_order_release);
+    pong->sequence++;
+}
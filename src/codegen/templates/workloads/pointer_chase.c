@@ -0,0 +1,71 @@
+// Pointer-chasing load latency. Every worker links the cache lines of a work_size byte buffer
+// into one random cycle (Sattolo's algorithm), so each load depends on the previous one and
+// neither the out-of-order core nor the prefetchers can run ahead. One call is one load: run
+// with batched latency (e.g. 64 calls per sample) to read the latency of a single load, and
+// sweep the work size with experiment_work_sweep = cache to see every level of the hierarchy.
+// The buffer uses transparent huge pages, see the TLB reach template for page walk costs.
+struct pointer_chase {
+    void**             buffer;
+    size_t             size;
+    void**             position;
+};
+
+void setup() {
+    if (EXPERIMENT_WORK_MIN_SIZE < 2 * CACHE_LINE_SIZE) {
+        fprintf(stderr, "The pointer chase needs experiment_work_min_size of at least %d bytes.\n", 2 * CACHE_LINE_SIZE);
+        exit(1);
+    }
+}
+
+void cleanup() {
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    struct pointer_chase* chase = context->user;
+    if (!chase) {
+        chase = context->user = calloc(1, sizeof(struct pointer_chase));
+    }
+
+    size_t line_count = context->work_size / CACHE_LINE_SIZE;
+    chase->size = line_count * CACHE_LINE_SIZE;
+    chase->buffer = workload_alloc(chase->size, CACHE_LINE_SIZE, WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    size_t* order = malloc(sizeof(size_t) * line_count);
+    if (!chase->buffer || !order) {
+        fprintf(stderr, "Failed to allocate a %zu byte pointer chase: %s\n", chase->size, strerror(errno));
+        exit(1);
+    }
+
+    // Sattolo's shuffle yields a single cycle through every line
+    for (size_t i = 0; i < line_count; ++i) {
+        order[i] = i;
+    }
+    for (size_t i = line_count - 1; i > 0; --i) {
+        size_t j = benchmark_random(context) % i;
+        size_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    const size_t stride = CACHE_LINE_SIZE / sizeof(void*);
+    for (size_t i = 0; i < line_count; ++i) {
+        chase->buffer[order[i] * stride] = &chase->buffer[order[(i + 1) % line_count] * stride];
+    }
+    chase->position = &chase->buffer[order[0] * stride];
+    free(order);
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    struct pointer_chase* chase = context->user;
+    workload_free(chase->buffer);
+    chase->buffer = NULL;
+
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        free(chase);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct pointer_chase* chase = context->user;
+    chase->position = *chase->position;
+}
@@ -0,0 +1,252 @@
+// Bounded queue handoff. Even workers produce and odd workers consume: every call enqueues or
+// dequeues one value, spinning while the queue is full or empty, and then spends work_size
+// iterations of think time (benchmark_delay). The configuration name picks the queue:
+//   spsc   a lock-free single-producer single-consumer ring per pair of workers (0 with 1, ...)
+//          that only touches the other side's index when its cached copy runs out
+//   mpmc   one lock-free multi-producer multi-consumer ring shared by all workers, with a
+//          sequence number per slot (Vyukov's bounded queue)
+//   mutex  one ring shared by all workers behind a pthread_mutex_t
+// The [Workload] section of config.ini sets the queue size:
+//   workload_capacity  slots per queue, a power of two (1024 by default)
+// Producers and consumers must make the same number of calls, so warmup and loop calibration,
+// which run every worker on its own, are not supported, and the thread counts must be even.
+#if !defined(CONFIG_SPSC) && !defined(CONFIG_MPMC) && !defined(CONFIG_MUTEX)
+#define CONFIG_MPMC // Configurations with other names measure the lock-free shared queue
+#endif
+
+#ifdef CONFIG_MPMC
+struct queue_slot {
+    atomic_size_t      sequence;
+    uint64_t           value;
+};
+#else
+struct queue_slot {
+    uint64_t           value;
+};
+#endif
+
+// The indices written by producers and by consumers live on cache lines of their own
+struct queue {
+#if defined(CONFIG_SPSC) || defined(CONFIG_MPMC)
+    atomic_size_t      head __attribute__((aligned(2 * CACHE_LINE_SIZE)));    // Next slot to dequeue
+    atomic_size_t      tail __attribute__((aligned(2 * CACHE_LINE_SIZE)));    // Next slot to enqueue
+#else
+    pthread_mutex_t    mutex __attribute__((aligned(2 * CACHE_LINE_SIZE)));
+    size_t             head;
+    size_t             tail;
+#endif
+    struct queue_slot* slots __attribute__((aligned(2 * CACHE_LINE_SIZE)));
+};
+
+struct queue_worker {
+    struct queue*      queue;
+    size_t             cached_index;   // The other side's index as last seen, for the spsc ring
+    uint64_t           sent;
+    uint64_t           checksum;       // Sum of the values enqueued or dequeued
+    int                side;           // 0 for the producer, 1 for the consumer
+};
+
+static struct queue*        queues = NULL;
+static size_t               queue_count = 0;
+static size_t               queue_mask = 0;
+static atomic_uint_fast64_t queue_produced = 0;
+static atomic_uint_fast64_t queue_consumed = 0;
+
+// Waiting workers yield now and then, so that workers sharing a CPU do not spin out their time slices
+#define QUEUE_WAIT(condition)                                           \
+    for (unsigned spins = 1; (condition); ++spins) {                    \
+        cpu_relax();                                                    \
+        if (spins % 4096 == 0) {                                        \
+            sched_yield();                                              \
+        }                                                               \
+    }
+
+static inline __attribute__((always_inline)) int queue_try_enqueue(struct queue_worker* worker, uint64_t value) {
+    struct queue* queue = worker->queue;
+#if defined(CONFIG_SPSC)
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - worker->cached_index > queue_mask) {
+        worker->cached_index = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - worker->cached_index > queue_mask) {
+            return 0;
+        }
+    }
+    queue->slots[tail & queue_mask].value = value;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+#elif defined(CONFIG_MPMC)
+    size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    for (;;) {
+        struct queue_slot* slot = &queue->slots[position & queue_mask];
+        intptr_t difference = (intptr_t)atomic_load_explicit(&slot->sequence, memory_order_acquire) - (intptr_t)position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                slot->value = value;
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                return 1;
+            }
+        } else if (difference < 0) {
+            return 0;
+        } else {
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+#else
+    int stored = 0;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->tail - queue->head <= queue_mask) {
+        queue->slots[queue->tail++ & queue_mask].value = value;
+        stored = 1;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return stored;
+#endif
+}
+
+static inline __attribute__((always_inline)) int queue_try_dequeue(struct queue_worker* worker, uint64_t* value) {
+    struct queue* queue = worker->queue;
+#if defined(CONFIG_SPSC)
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == worker->cached_index) {
+        worker->cached_index = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head == worker->cached_index) {
+            return 0;
+        }
+    }
+    *value = queue->slots[head & queue_mask].value;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 1;
+#elif defined(CONFIG_MPMC)
+    size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;) {
+        struct queue_slot* slot = &queue->slots[position & queue_mask];
+        intptr_t difference = (intptr_t)atomic_load_explicit(&slot->sequence, memory_order_acquire) - (intptr_t)(position + 1);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *value = slot->value;
+                atomic_store_explicit(&slot->sequence, position + queue_mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (difference < 0) {
+            return 0;
+        } else {
+            position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+#else
+    int loaded = 0;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->head != queue->tail) {
+        *value = queue->slots[queue->head++ & queue_mask].value;
+        loaded = 1;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return loaded;
+#endif
+}
+
+void setup() {
+    if (EXPERIMENT_THREAD_MAX < 2 || EXPERIMENT_THREAD_MIN % 2 != 0 || EXPERIMENT_THREAD_STEP % 2 != 0) {
+        fprintf(stderr, "The queue test pairs producers with consumers: set experiment_thread_min, _max and _step to even numbers.\n");
+        exit(1);
+    }
+    if (EXPERIMENT_WARMUP != WARMUP_OFF || EXPERIMENT_LOOP_CALIBRATION != LOOP_CALIBRATION_OFF) {
+        fprintf(stderr, "The queue test needs experiment_warmup and experiment_loop_calibration set to off.\n");
+        exit(1);
+    }
+    size_t capacity = get_config_size("workload_capacity", 1024);
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "workload_capacity must be a power of two of at least 2.\n");
+        exit(1);
+    }
+    queue_mask = capacity - 1;
+
+    // The queues are never reset: every size ends with them drained, and the indices carry on
+#ifdef CONFIG_SPSC
+    queue_count = EXPERIMENT_THREAD_MAX / 2;
+#else
+    queue_count = 1;
+#endif
+    queues = workload_alloc(sizeof(struct queue) * queue_count, 2 * CACHE_LINE_SIZE,
+                            WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+    if (!queues) {
+        fprintf(stderr, "Failed to allocate the queues: %s\n", strerror(errno));
+        exit(1);
+    }
+    for (size_t q = 0; q < queue_count; ++q) {
+        struct queue* queue = &queues[q];
+        queue->slots = workload_alloc(sizeof(struct queue_slot) * capacity, CACHE_LINE_SIZE,
+                                      WORKLOAD_PAGES_THP | WORKLOAD_POPULATE, WORKLOAD_NODE_ANY);
+        if (!queue->slots) {
+            fprintf(stderr, "Failed to allocate %zu queue slots: %s\n", capacity, strerror(errno));
+            exit(1);
+        }
+    #if defined(CONFIG_SPSC) || defined(CONFIG_MPMC)
+        atomic_store(&queue->head, 0);
+        atomic_store(&queue->tail, 0);
+    #else
+        pthread_mutex_init(&queue->mutex, NULL);
+        queue->head = queue->tail = 0;
+    #endif
+    #ifdef CONFIG_MPMC
+        for (size_t i = 0; i < capacity; ++i) {
+            atomic_store(&queue->slots[i].sequence, i);
+        }
+    #endif
+    }
+}
+
+void cleanup() {
+    uint64_t produced = atomic_load(&queue_produced);
+    uint64_t consumed = atomic_load(&queue_consumed);
+    if (produced != consumed) {
+        fprintf(stderr, "Error: the values dequeued sum to %lu instead of %lu.\n", consumed, produced);
+    }
+    for (size_t q = 0; q < queue_count; ++q) {
+    #ifdef CONFIG_MUTEX
+        pthread_mutex_destroy(&queues[q].mutex);
+    #endif
+        workload_free(queues[q].slots);
+    }
+    workload_free(queues);
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    struct queue_worker* worker = context->user;
+    if (!worker) {
+        worker = context->user = calloc(1, sizeof(struct queue_worker));
+        worker->side = context->thread_id % 2;
+    #ifdef CONFIG_SPSC
+        worker->queue = &queues[context->thread_id / 2];
+        // Start from the indices the previous thread count left behind
+        worker->cached_index = worker->side == 0 ? atomic_load(&worker->queue->head) : atomic_load(&worker->queue->tail);
+    #else
+        worker->queue = &queues[0];
+    #endif
+    }
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        struct queue_worker* worker = context->user;
+        atomic_fetch_add(worker->side == 0 ? &queue_produced : &queue_consumed, worker->checksum);
+        free(worker);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct queue_worker* worker = context->user;
+    uint64_t value;
+    if (worker->side == 0) {
+        value = ++worker->sent;
+        QUEUE_WAIT(!queue_try_enqueue(worker, value));
+    } else {
+        QUEUE_WAIT(!queue_try_dequeue(worker, &value));
+    }
+    worker->checksum += value;
+    benchmark_delay(context->work_size);
+}
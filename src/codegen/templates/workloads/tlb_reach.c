@@ -0,0 +1,96 @@
+// TLB reach. The work size is a number of pages, and every worker links one cache line in each
+// of them into a random cycle of dependent loads. The data touched is only one line per page,
+// so it stays cache resident far longer than the translations stay in the TLB: latency steps up
+// once the pages exceed each TLB level and again when the page walks miss the caches. One call
+// is one load, run with batched latency to resolve it.
+// The [Workload] section of config.ini selects the page size:
+//   workload_pages  4k (the default, transparent huge pages are turned off), 2mb or 1gb. Explicit
+//                   huge pages come from the hugetlb pool, so reserve enough of them first.
+// Lines are placed at varying offsets within their pages so that they do not all map to the
+// same cache sets.
+struct tlb_reach {
+    char*              buffer;
+    size_t             pages;
+    void**             position;
+};
+
+static size_t tlb_page_size = 0;
+static int    tlb_page_flags = 0;
+
+void setup() {
+    static const char* const page_sizes[] = { "4k", "2mb", "1gb", NULL };
+    static const int page_flags[] = { 0, WORKLOAD_PAGES_2MB, WORKLOAD_PAGES_1GB };
+    static const size_t page_bytes[] = { 4096, (size_t)1 << WORKLOAD_HUGE_2MB_SHIFT, (size_t)1 << WORKLOAD_HUGE_1GB_SHIFT };
+    int choice = get_config_choice("workload_pages", page_sizes, 0);
+    tlb_page_flags = page_flags[choice];
+    tlb_page_size = page_bytes[choice];
+    if (choice == 0 && (size_t)sysconf(_SC_PAGESIZE) != tlb_page_size) {
+        tlb_page_size = (size_t)sysconf(_SC_PAGESIZE);
+        printf("Base pages are %zu bytes on this system.\n", tlb_page_size);
+    }
+    if (EXPERIMENT_WORK_MIN_SIZE < 2) {
+        fprintf(stderr, "The TLB reach test needs experiment_work_min_size of at least 2 pages.\n");
+        exit(1);
+    }
+}
+
+void cleanup() {
+}
+
+void setup_work_size(struct benchmark_context* context) {
+    struct tlb_reach* reach = context->user;
+    if (!reach) {
+        reach = context->user = calloc(1, sizeof(struct tlb_reach));
+    }
+
+    reach->pages = context->work_size;
+    size_t size = reach->pages * tlb_page_size;
+    reach->buffer = workload_alloc(size, tlb_page_size, tlb_page_flags, WORKLOAD_NODE_ANY);
+    size_t* order = malloc(sizeof(size_t) * reach->pages);
+    if (!reach->buffer || !order) {
+        fprintf(stderr, "Failed to allocate %zu pages of %zu bytes: %s\n", reach->pages, tlb_page_size, strerror(errno));
+        exit(1);
+    }
+    // Base pages must stay base pages, whatever the system's transparent huge page policy
+    if (tlb_page_flags == 0 && madvise(reach->buffer, size, MADV_NOHUGEPAGE) != 0) {
+        fprintf(stderr, "Warning: failed to disable transparent huge pages: %s\n", strerror(errno));
+    }
+
+    // Sattolo's shuffle yields a single cycle through every page
+    for (size_t i = 0; i < reach->pages; ++i) {
+        order[i] = i;
+    }
+    for (size_t i = reach->pages - 1; i > 0; --i) {
+        size_t j = benchmark_random(context) % i;
+        size_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+
+    // Consecutive pages use consecutive lines, wrapping within the first 4 KB of the page
+    size_t line_count = 4096 / CACHE_LINE_SIZE;
+    #define TLB_LINE(page) ((void**)(reach->buffer + (page) * tlb_page_size + ((page) % line_count) * CACHE_LINE_SIZE))
+    for (size_t i = 0; i < reach->pages; ++i) {
+        *TLB_LINE(order[i]) = TLB_LINE(order[(i + 1) % reach->pages]);
+    }
+    reach->position = TLB_LINE(order[0]);
+    #undef TLB_LINE
+    free(order);
+}
+
+void teardown_work_size(struct benchmark_context* context) {
+    struct tlb_reach* reach = context->user;
+    workload_free(reach->buffer);
+    reach->buffer = NULL;
+
+    // The context outlives the sweep, release the state after the largest size
+    if (context->work_size == EXPERIMENT_WORK_SIZES[EXPERIMENT_WORK_SIZE_COUNT - 1]) {
+        free(reach);
+        context->user = NULL;
+    }
+}
+
+static inline __attribute__((always_inline)) void benchmark_function(struct benchmark_context* context) {
+    struct tlb_reach* reach = context->user;
+    reach->position = *reach->position;
+}
@@ -7,7 +7,12 @@
 #pragma GCC diagnostic pop
 
 #include "cli.h"
+#include "results.h"
+#include "stats.h"
+#include "history.h"
 #include <limits.h>
+#include <math.h>
+#include <time.h>
 #include <libgen.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -21,14 +26,19 @@ void handle_exp_help();
 void handle_exp_list();
 void handle_exp_create();
 void handle_exp_delete(char *name);
-void handle_exp_info(char *name);
+void handle_exp_info(char *name, char *run);
+void handle_exp_report(char *name);
+int handle_exp_compare(char *name, char *config_a, char *config_b, double threshold, int replicates, int threads);
+int handle_exp_history(char *name, char *config_name, char *statistic, int record_only);
 void handle_sysinfo();
 
 void get_archiplex_root_dir(char *root_path);
 void get_archiplex_experiments_dir(char *dir);
+int find_experiment(const char *name, char *experiment_path);
 void launch_tool(const char *tool_name, char *const argv[]);
 
-void cli_main(int argc, char **argv) {
+int cli_main(int argc, char **argv) {
+    int status = 0;
     struct optparse options;
     optparse_init(&options, argv);
     char *arg = optparse_arg(&options); // Skip program name
@@ -64,11 +74,100 @@ void cli_main(int argc, char **argv) {
             if (name == NULL) {
                 printf(COLOR_RED "Experiment name required for info.\n" COLOR_RESET);
             } else {
-                handle_exp_info(name);
+                handle_exp_info(name, optparse_arg(&options));
+            }
+        } else if (strcmp(arg, "report") == 0) {
+            char *name = optparse_arg(&options);
+            if (name == NULL) {
+                printf(COLOR_RED "Experiment name required for report.\n" COLOR_RESET);
+            } else {
+                handle_exp_report(name);
+            }
+        } else if (strcmp(arg, "compare") == 0) {
+            char *positional[3] = { NULL, NULL, NULL };
+            int positional_count = 0;
+            double threshold = 0.05;
+            int replicates = 1000;
+            int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+            while ((arg = optparse_arg(&options)) != NULL) {
+                if (strcmp(arg, "--threshold") == 0) { // Next argument is the relative change that counts as a regression
+                    arg = optparse_arg(&options);
+                    if (arg == NULL || atof(arg) <= 0) {
+                        printf(COLOR_RED "Expected a positive relative change after '--threshold'.\n" COLOR_RESET);
+                        return 2;
+                    }
+                    threshold = atof(arg);
+                } else if (strcmp(arg, "--replicates") == 0) { // Next argument is the number of bootstrap replicates
+                    arg = optparse_arg(&options);
+                    if (arg == NULL || atoi(arg) < 100) {
+                        printf(COLOR_RED "Expected at least 100 replicates after '--replicates'.\n" COLOR_RESET);
+                        return 2;
+                    }
+                    replicates = atoi(arg);
+                } else if (strcmp(arg, "-j") == 0) { // Next argument is the number of bootstrap threads
+                    arg = optparse_arg(&options);
+                    if (arg == NULL || atoi(arg) < 1) {
+                        printf(COLOR_RED "Expected a positive number of threads after '-j'.\n" COLOR_RESET);
+                        return 2;
+                    }
+                    threads = atoi(arg);
+                } else if (positional_count < 3) {
+                    positional[positional_count++] = arg;
+                } else {
+                    printf(COLOR_RED "Unexpected argument: %s\n" COLOR_RESET, arg);
+                    return 2;
+                }
+            }
+
+            if (positional_count < 3) {
+                printf(COLOR_RED "Experiment name and two configurations required for compare.\n" COLOR_RESET);
+                status = 2;
+            } else {
+                status = handle_exp_compare(positional[0], positional[1], positional[2], threshold, replicates, threads);
+            }
+        } else if (strcmp(arg, "history") == 0) {
+            char *name = NULL;
+            char *config_name = NULL;
+            char *statistic = NULL;
+            int record_only = 0;
+
+            while ((arg = optparse_arg(&options)) != NULL) {
+                if (strcmp(arg, "-c") == 0) { // Next argument is the configuration to show
+                    config_name = optparse_arg(&options);
+                    if (config_name == NULL) {
+                        printf(COLOR_RED "Expected a configuration name after '-c'.\n" COLOR_RESET);
+                        return 1;
+                    }
+                } else if (strcmp(arg, "--statistic") == 0) { // Next argument is the statistic to track
+                    statistic = optparse_arg(&options);
+                    if (statistic == NULL) {
+                        printf(COLOR_RED "Expected one of p50, p99, p99.9, mean or ops after '--statistic'.\n" COLOR_RESET);
+                        return 1;
+                    }
+                } else if (strcmp(arg, "--record") == 0) {
+                    record_only = 1;
+                } else if (name == NULL) {
+                    name = arg;
+                } else {
+                    printf(COLOR_RED "Unexpected argument: %s\n" COLOR_RESET, arg);
+                    return 1;
+                }
+            }
+
+            if (name == NULL) {
+                printf(COLOR_RED "Experiment name required for history.\n" COLOR_RESET);
+                status = 1;
+            } else {
+                status = handle_exp_history(name, config_name, statistic, record_only);
             }
         } else if (strcmp(arg, "run") == 0) {
             char *path_to_experiment_dir = NULL;
             char *config_name = "";
+            char *parallel_jobs = NULL;
+            char *ci_width = NULL;
+            char *isolate_cpus = NULL;
+            int isolate = 0, no_turbo = 0, no_smt = 0;
             int verbose = 0; // Verbose flag
 
             // Process further arguments to find optional parameters
@@ -77,8 +176,32 @@ void cli_main(int argc, char **argv) {
                     config_name = optparse_arg(&options);
                     if (config_name == NULL) {
                         printf(COLOR_RED "Expected configuration name after '-c'.\n" COLOR_RESET);
-                        return;
+                        return 1;
+                    }
+                } else if (strcmp(arg, "-j") == 0) { // Next argument is the number of parallel jobs
+                    parallel_jobs = optparse_arg(&options);
+                    if (parallel_jobs == NULL || atoi(parallel_jobs) < 1) {
+                        printf(COLOR_RED "Expected a positive number of jobs after '-j'.\n" COLOR_RESET);
+                        return 1;
                     }
+                } else if (strcmp(arg, "--ci-width") == 0) { // Next argument is the target relative CI width
+                    ci_width = optparse_arg(&options);
+                    if (ci_width == NULL || atof(ci_width) <= 0) {
+                        printf(COLOR_RED "Expected a positive relative width after '--ci-width'.\n" COLOR_RESET);
+                        return 1;
+                    }
+                } else if (strcmp(arg, "--isolate") == 0) {
+                    isolate = 1;
+                } else if (strcmp(arg, "--cpus") == 0) { // Next argument is the CPU list isolated runs are pinned to
+                    isolate_cpus = optparse_arg(&options);
+                    if (isolate_cpus == NULL) {
+                        printf(COLOR_RED "Expected a CPU list such as 2-5 after '--cpus'.\n" COLOR_RESET);
+                        return 1;
+                    }
+                } else if (strcmp(arg, "--no-turbo") == 0) {
+                    no_turbo = 1;
+                } else if (strcmp(arg, "--no-smt") == 0) {
+                    no_smt = 1;
                 } else if (strcmp(arg, "-v") == 0) {
                     verbose = 1;
                 } else if (strcmp(arg, "-vv") == 0) {
@@ -90,7 +213,7 @@ void cli_main(int argc, char **argv) {
                     } else {
                         // More than one path-like argument encountered
                         printf(COLOR_RED "Unexpected argument: %s\n" COLOR_RESET, arg);
-                        return;
+                        return 1;
                     }
                 }
             }
@@ -102,17 +225,40 @@ void cli_main(int argc, char **argv) {
                     path_to_experiment_dir = cwd;
                 } else {
                     perror("getcwd");
-                    return;
+                    return 1;
                 }
             }
 
-            char *tool_args[] = {
-                "run_experiment.sh",
-                path_to_experiment_dir,
-                config_name,
-                (verbose == 2) ? "-vv" : (verbose ? "-v" : NULL),
-                NULL
-            };
+            char *tool_args[16];
+            int tool_argc = 0;
+            tool_args[tool_argc++] = "run_experiment.sh";
+            tool_args[tool_argc++] = path_to_experiment_dir;
+            tool_args[tool_argc++] = config_name;
+            if (verbose) {
+                tool_args[tool_argc++] = (verbose == 2) ? "-vv" : "-v";
+            }
+            if (parallel_jobs) {
+                tool_args[tool_argc++] = "-j";
+                tool_args[tool_argc++] = parallel_jobs;
+            }
+            if (ci_width) {
+                tool_args[tool_argc++] = "--ci-width";
+                tool_args[tool_argc++] = ci_width;
+            }
+            if (isolate) {
+                tool_args[tool_argc++] = "--isolate";
+            }
+            if (isolate_cpus) {
+                tool_args[tool_argc++] = "--cpus";
+                tool_args[tool_argc++] = isolate_cpus;
+            }
+            if (no_turbo) {
+                tool_args[tool_argc++] = "--no-turbo";
+            }
+            if (no_smt) {
+                tool_args[tool_argc++] = "--no-smt";
+            }
+            tool_args[tool_argc] = NULL;
             launch_tool("run_experiment.sh", tool_args);
         } else {
             printf(COLOR_RED "Unknown exp command.\n" COLOR_RESET);
@@ -122,6 +268,7 @@ void cli_main(int argc, char **argv) {
     } else {
         printf(COLOR_RED "Unknown command. Use 'archiplex help' for usage.\n" COLOR_RESET);
     }
+    return status;
 }
 
 void handle_help() {
@@ -145,10 +292,21 @@ void handle_help() {
     printf("Launch an experiment creation tool.\n");
     LOG_INFO("    exp delete <name> ");
     printf("Delete an experiment by name.\n");
-    LOG_INFO("    exp run [path] [-c <config>,<config2>,...] [-v] [-vv]\n");
+    LOG_INFO("    exp run [path] [-c <config>,<config2>,...] [-j <jobs>] [-v] [-vv]\n");
     printf("                      Runs the experiment in the current directory unless specifies otherwise.\n");
-    LOG_INFO("    exp info <name>   ");
-    printf("Display information about an experiment.\n\n");
+    printf("                      With -j, configurations are built concurrently and run in parallel on disjoint CPUs.\n");
+    printf("                      Each configuration is repeated experiment_iterations times, --ci-width <w> stops\n");
+    printf("                      early once the 95%% CI of the mean throughput is narrower than w (e.g. 0.01).\n");
+    printf("                      --isolate pins runs to --cpus <list>, locks memory, uses SCHED_FIFO and the performance\n");
+    printf("                      governor, --no-turbo and --no-smt also disable turbo and SMT siblings until the run ends.\n");
+    LOG_INFO("    exp report <name> ");
+    printf("Summarize latency and throughput of all runs per configuration and work size.\n");
+    LOG_INFO("    exp compare <name> <configA> <configB> [--threshold <f>] [--replicates <n>] [-j <threads>]\n");
+    printf("                      Tests whether configB differs from configA per work size and exits with 1 on a regression.\n");
+    LOG_INFO("    exp history <name> [-c <config>] [--statistic <p50|p99|p99.9|mean|ops>] [--record]\n");
+    printf("                      Record completed runs in data/history.tsv and show trends and CUSUM change points.\n");
+    LOG_INFO("    exp info <name> [run]\n");
+    printf("                      Display an experiment's settings and the machine and build manifest of a run (default: latest).\n\n");
 
     printf("  Tool Commands:\n");
     LOG_INFO("    tools help        ");
@@ -181,8 +339,51 @@ void handle_exp_help() {
     LOG_INFO("    run [path] [-c <config>,<config2>,...] [-v]  ");
     printf("Runs the experiment in the current directory unless specifies otherwise. Optionally can specify the configuratioin to run\n");
 
-    LOG_INFO("    info   <name>                                ");
-    printf("Displays information related to a specified experiment.\n\n");
+    LOG_INFO("        [-j <jobs>]                              ");
+    printf("Builds all configurations concurrently and runs up to <jobs> of them in parallel on disjoint CPU sets.\n");
+
+    LOG_INFO("        [--ci-width <w>]                         ");
+    printf("Stops repeating a configuration once the 95%% CI of its mean throughput is narrower than w relative to the mean.\n");
+
+    LOG_INFO("        [--isolate [--cpus <list>]]              ");
+    printf("Pins runs to the given CPUs (default: isolated CPUs, else all but CPU 0's core), locks memory, runs with SCHED_FIFO\n");
+    LOG_INFO("                                                 ");
+    printf("and sets the performance governor. Every change is restored on exit and recorded in the run's manifest.ini.\n");
+
+    LOG_INFO("        [--no-turbo] [--no-smt]                  ");
+    printf("With --isolate, also disables turbo and the SMT siblings of the pinned CPUs.\n");
+
+    LOG_INFO("    report <name>                                ");
+    printf("Streams every result under data/raw once and prints count, mean, stddev, min/max and p50/p90/p99/p99.9\n");
+    LOG_INFO("                                                 ");
+    printf("latency and mean throughput per configuration, thread count and work size to data/processed/report.csv.\n");
+
+    LOG_INFO("    compare <name> <configA> <configB>           ");
+    printf("Compares p50/p99/p99.9 latency and throughput of configB against configA over all runs, per thread count\n");
+    LOG_INFO("                                                 ");
+    printf("and work size, with a Mann-Whitney U test and bootstrap 95%% confidence intervals of the relative change.\n");
+    LOG_INFO("        [--threshold <f>]                        ");
+    printf("Relative change that counts as a regression (default 0.05). The command exits with 1 if any statistic\n");
+    LOG_INFO("                                                 ");
+    printf("is worse by more than f with 95%% confidence and the Mann-Whitney test is significant at the 5%% level.\n");
+    LOG_INFO("        [--replicates <n>] [-j <threads>]        ");
+    printf("Bootstrap replicates (default 1000) and the threads resampling them (default: all CPUs).\n\n");
+
+    LOG_INFO("    history <name> [-c <config>]                 ");
+    printf("Adds every completed run that is not recorded yet to the experiment's append-only data/history.tsv, then\n");
+    LOG_INFO("                                                 ");
+    printf("shows the trend of each configuration, thread count and work size over all recorded runs and the runs\n");
+    LOG_INFO("                                                 ");
+    printf("where a CUSUM detector found a lasting shift. 'exp run' records every run it completes.\n");
+    LOG_INFO("        [--statistic <p50|p99|p99.9|mean|ops>]   ");
+    printf("Statistic to follow (default: p50 latency, or ops/s for throughput-only benchmarks).\n");
+    LOG_INFO("        [--record]                               ");
+    printf("Only records new runs.\n\n");
+
+    LOG_INFO("    info   <name> [run]                          ");
+    printf("Displays the experiment's settings and the manifest of a run (default: the latest one). Every run records\n");
+    LOG_INFO("                                                 ");
+    printf("the CPU, frequencies, governor, turbo/SMT state, kernel, compiler, flags and config.ini in manifest.ini.\n\n");
 }
 
 void handle_exp_list() {
@@ -288,8 +489,742 @@ void handle_exp_delete(char *name) {
     }
 }
 
-void handle_exp_info(char *name) {
-    printf(COLOR_CYAN "Get experiment info for '%s'\n" COLOR_RESET, name);
+// Prints the values of the given keys in an experiment's config.ini
+static void print_config_summary(const char *config_path) {
+    static const char *keys[][2] = {
+        { "experiment_version", "Version" },
+        { "experiment_configurations", "Configurations" },
+        { "experiment_iterations", "Iterations" },
+        { "experiment_run_id", "Next run ID" },
+    };
+
+    FILE *file = fopen(config_path, "r");
+    if (file == NULL) {
+        LOG_WARN("  No configuration file at %s\n", config_path);
+        return;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+            size_t length = strlen(keys[i][0]);
+            if (strncmp(line, keys[i][0], length) == 0 && strncmp(line + length, " = ", 3) == 0) {
+                printf("  %-18s: %s", keys[i][1], line + length + 3);
+            }
+        }
+    }
+    fclose(file);
+}
+
+// Prints a run manifest, leaving out the copy of config.ini it ends with
+static void print_manifest(const char *manifest_path) {
+    FILE *file = fopen(manifest_path, "r");
+    if (file == NULL) {
+        LOG_WARN("  No manifest recorded.\n");
+        return;
+    }
+
+    char line[4096];
+    int skip = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '[') {
+            skip = strncmp(line, "[config.", 8) == 0;
+            if (!skip) LOG_INFO("  %s", line);
+        } else if (!skip && line[0] != '\n') {
+            printf("    %s", line);
+        }
+    }
+    fclose(file);
+}
+
+static int select_directories(const struct dirent *entry) {
+    return entry->d_type == DT_DIR && entry->d_name[0] != '.';
+}
+
+// Resolves the directory of a registered experiment, returns 0 if it exists. Names that
+// contain a slash are taken as paths, so experiments outside the experiments directory work too.
+int find_experiment(const char *name, char *experiment_path) {
+    char experiments_dir[PATH_MAX];
+    get_archiplex_experiments_dir(experiments_dir);
+
+    int needed = strchr(name, '/') ? snprintf(experiment_path, PATH_MAX, "%s", name)
+                                   : snprintf(experiment_path, PATH_MAX, "%s/%s", experiments_dir, name);
+    if (needed >= PATH_MAX) {
+        fprintf(stderr, "Error: Path too long.\n");
+        return -1;
+    }
+
+    struct stat statbuf;
+    if (stat(experiment_path, &statbuf) == -1 || !S_ISDIR(statbuf.st_mode)) {
+        LOG_ERROR("Experiment '%s' not found.\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+void handle_exp_info(char *name, char *run) {
+    char experiment_path[PATH_MAX];
+    if (find_experiment(name, experiment_path) != 0) {
+        return;
+    }
+
+    LOG_INFO("Experiment '%s'\n", name);
+    printf("  %-18s: %s\n", "Path", experiment_path);
+
+    char path[PATH_MAX + 32]; // Room for the suffixes appended to the experiment path
+    snprintf(path, sizeof(path), "%s/config/config.ini", experiment_path);
+    print_config_summary(path);
+
+    // Runs are stored as data/raw/run_<id>, by default the manifests of the latest one are shown
+    snprintf(path, sizeof(path), "%s/data/raw", experiment_path);
+    int run_count = 0, run_id = -1;
+    DIR *d = opendir(path);
+    if (d) {
+        struct dirent *dir;
+        int id;
+        char end;
+        while ((dir = readdir(d)) != NULL) {
+            if (sscanf(dir->d_name, "run_%d%c", &id, &end) == 1) {
+                run_count++;
+                if (id > run_id) run_id = id;
+            }
+        }
+        closedir(d);
+    }
+    printf("  %-18s: %d\n", "Recorded runs", run_count);
+
+    if (run != NULL) {
+        char *end;
+        long requested = strtol(run, &end, 10);
+        if (*end != '\0' || requested < 0 || requested > INT_MAX) {
+            LOG_ERROR("Invalid run ID '%s'.\n", run);
+            return;
+        }
+        run_id = (int)requested;
+    }
+    if (run_id < 0) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/data/raw/run_%d", experiment_path, run_id);
+    struct dirent **configurations;
+    int count = scandir(path, &configurations, select_directories, alphasort);
+    if (count < 0) {
+        LOG_ERROR("Run %d not found.\n", run_id);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        char manifest_path[PATH_MAX + 32];
+        int needed = snprintf(manifest_path, sizeof(manifest_path), "%s/%s/manifest.ini", path, configurations[i]->d_name);
+        printf("\n");
+        LOG_INFO("Run %d, configuration '%s'\n", run_id, configurations[i]->d_name);
+        if (needed < sizeof(manifest_path)) {
+            print_manifest(manifest_path);
+        }
+        free(configurations[i]);
+    }
+    free(configurations);
+}
+
+// Results of one configuration, thread count and work size, aggregated over all runs
+struct report_group {
+    char          configuration[256];
+    uint32_t      threads;
+    uint64_t      work_size;
+    int           runs;
+    int           last_run;             // Latency files are scanned in run order, one per run
+    struct sketch latency;
+    uint64_t      throughput_count;     // One throughput value per run, summarized with Welford's method
+    double        throughput_mean;
+    double        throughput_m2;
+};
+
+struct report {
+    struct report_group **groups;
+    int                   count;
+    int                   capacity;
+};
+
+static struct report_group *report_group(struct report *report, const struct result_source *source,
+                                         uint32_t threads, uint64_t work_size) {
+    struct report_group *group = NULL;
+    for (int i = report->count - 1; i >= 0; --i) {
+        struct report_group *candidate = report->groups[i];
+        if (candidate->threads == threads && candidate->work_size == work_size &&
+            strcmp(candidate->configuration, source->configuration) == 0) {
+            group = candidate;
+            break;
+        }
+    }
+
+    if (group == NULL) {
+        if (report->count == report->capacity) {
+            report->capacity = report->capacity ? report->capacity * 2 : 64;
+            report->groups = realloc(report->groups, report->capacity * sizeof(*report->groups));
+        }
+        group = calloc(1, sizeof(*group));
+        if (report->groups == NULL || group == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            exit(1);
+        }
+        snprintf(group->configuration, sizeof(group->configuration), "%s", source->configuration);
+        group->threads = threads;
+        group->work_size = work_size;
+        group->last_run = -1;
+        sketch_init(&group->latency);
+        report->groups[report->count++] = group;
+    }
+    return group;
+}
+
+static struct sketch *report_select_latency(void *user, const struct result_source *source,
+                                            uint32_t threads, uint64_t work_size) {
+    struct report_group *group = report_group(user, source, threads, work_size);
+    if (group->last_run != source->run_id) {
+        group->last_run = source->run_id;
+        group->runs++;
+    }
+    return &group->latency;
+}
+
+static void report_add_throughput(void *user, const struct result_source *source,
+                                  uint32_t threads, uint64_t work_size, double ops_per_sec) {
+    struct report_group *group = report_group(user, source, threads, work_size);
+    group->throughput_count++;
+    double delta = ops_per_sec - group->throughput_mean;
+    group->throughput_mean += delta / group->throughput_count;
+    group->throughput_m2 += delta * (ops_per_sec - group->throughput_mean);
+}
+
+static int compare_report_groups(const void *a, const void *b) {
+    const struct report_group *x = *(struct report_group *const *)a;
+    const struct report_group *y = *(struct report_group *const *)b;
+    int order = strcmp(x->configuration, y->configuration);
+    if (order != 0) return order;
+    if (x->threads != y->threads) return x->threads < y->threads ? -1 : 1;
+    if (x->work_size != y->work_size) return x->work_size < y->work_size ? -1 : 1;
+    return 0;
+}
+
+// Streams every result file of an experiment once and summarizes latency and throughput per
+// configuration, thread count and work size. The table is printed and written to
+// data/processed/report.csv. Latencies are reported in nanoseconds.
+void handle_exp_report(char *name) {
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+    char experiment_path[PATH_MAX];
+    if (find_experiment(name, experiment_path) != 0) {
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct report report = { 0 };
+    int latency_files = results_scan_latency(experiment_path, NULL, report_select_latency, &report);
+    int throughput_files = results_scan_throughput(experiment_path, NULL, report_add_throughput, &report);
+    if (latency_files < 0) {
+        LOG_ERROR("No results found in %s/data/raw.\n", experiment_path);
+        return;
+    }
+    qsort(report.groups, report.count, sizeof(*report.groups), compare_report_groups);
+
+    char csv_path[PATH_MAX + 32];
+    snprintf(csv_path, sizeof(csv_path), "%s/data/processed", experiment_path);
+    mkdir(csv_path, 0777);
+    snprintf(csv_path, sizeof(csv_path), "%s/data/processed/report.csv", experiment_path);
+    FILE *csv = fopen(csv_path, "w");
+    if (csv == NULL) {
+        perror("Failed to create report.csv");
+    } else {
+        fprintf(csv, "configuration,threads,work_size,runs,count,mean_ns,stddev_ns,min_ns,p50_ns,p90_ns,p99_ns,p99_9_ns,max_ns,"
+                     "ops_per_sec_mean,ops_per_sec_stddev\n");
+    }
+
+    printf("%-16s %7s %12s %5s %12s %11s %11s %11s %11s %11s %11s %11s %11s %14s\n",
+           "Configuration", "Threads", "Work size", "Runs", "Samples", "Mean", "Stddev", "Min",
+           "p50", "p90", "p99", "p99.9", "Max", "Ops/s");
+    for (int i = 0; i < report.count; ++i) {
+        struct report_group *group = report.groups[i];
+        struct sketch *latency = &group->latency;
+        double throughput_stddev = group->throughput_count > 1 ? sqrt(group->throughput_m2 / (group->throughput_count - 1)) : 0;
+        if (group->runs < (int)group->throughput_count) {
+            group->runs = (int)group->throughput_count;
+        }
+
+        printf("%-16.16s %7u %12lu %5d %12lu", group->configuration, group->threads, group->work_size, group->runs, latency->count);
+        if (csv) fprintf(csv, "%s,%u,%lu,%d,%lu,", group->configuration, group->threads, group->work_size, group->runs, latency->count);
+        if (latency->count) {
+            double mean = sketch_to_ns(latency, sketch_mean(latency));
+            double stddev = sketch_to_ns(latency, sketch_stddev(latency));
+            double min = sketch_to_ns(latency, latency->min);
+            printf(" %11.3f %11.3f %11.3f", mean, stddev, min);
+            if (csv) fprintf(csv, "%.3f,%.3f,%.3f,", mean, stddev, min);
+            for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p) {
+                double value = sketch_to_ns(latency, sketch_percentile(latency, percentiles[p]));
+                printf(" %11.3f", value);
+                if (csv) fprintf(csv, "%.3f,", value);
+            }
+            printf(" %11.3f", sketch_to_ns(latency, latency->max));
+            if (csv) fprintf(csv, "%.3f,", sketch_to_ns(latency, latency->max));
+        } else {
+            printf(" %11s %11s %11s %11s %11s %11s %11s %11s", "-", "-", "-", "-", "-", "-", "-", "-");
+            if (csv) fprintf(csv, ",,,,,,,,");
+        }
+        if (group->throughput_count) {
+            printf(" %14.1f\n", group->throughput_mean);
+            if (csv) fprintf(csv, "%f,%f\n", group->throughput_mean, throughput_stddev);
+        } else {
+            printf(" %14s\n", "-");
+            if (csv) fprintf(csv, ",\n");
+        }
+
+        sketch_free(latency);
+        free(group);
+    }
+    free(report.groups);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("\nAggregated %d latency and %d throughput files in %.2f s", latency_files, throughput_files, elapsed);
+    if (csv) {
+        printf(", summary written to %s", csv_path);
+        fclose(csv);
+    }
+    printf("\n");
+}
+
+// Results of one thread count and work size of the two compared configurations, with one
+// latency sketch and throughput value per run
+struct compare_group {
+    uint32_t        threads;
+    uint64_t        work_size;
+    struct sketch **runs[2];
+    int             run_count[2];
+    int             last_run[2];
+    double         *throughput[2];
+    int             throughput_count[2];
+};
+
+struct comparison {
+    const char            *configurations[2];
+    struct compare_group **groups;
+    int                    count;
+    int                    capacity;
+};
+
+static struct compare_group *comparison_group(struct comparison *comparison, uint32_t threads, uint64_t work_size) {
+    for (int i = comparison->count - 1; i >= 0; --i) {
+        if (comparison->groups[i]->threads == threads && comparison->groups[i]->work_size == work_size) {
+            return comparison->groups[i];
+        }
+    }
+
+    if (comparison->count == comparison->capacity) {
+        comparison->capacity = comparison->capacity ? comparison->capacity * 2 : 64;
+        comparison->groups = realloc(comparison->groups, comparison->capacity * sizeof(*comparison->groups));
+    }
+    struct compare_group *group = calloc(1, sizeof(*group));
+    if (comparison->groups == NULL || group == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    group->threads = threads;
+    group->work_size = work_size;
+    group->last_run[0] = group->last_run[1] = -1;
+    comparison->groups[comparison->count++] = group;
+    return group;
+}
+
+static int comparison_side(struct comparison *comparison, const struct result_source *source) {
+    for (int side = 0; side < 2; ++side) {
+        if (strcmp(comparison->configurations[side], source->configuration) == 0) {
+            return side;
+        }
+    }
+    return -1;
+}
+
+static struct sketch *comparison_select_latency(void *user, const struct result_source *source,
+                                                uint32_t threads, uint64_t work_size) {
+    struct comparison *comparison = user;
+    int side = comparison_side(comparison, source);
+    if (side < 0) {
+        return NULL;
+    }
+
+    struct compare_group *group = comparison_group(comparison, threads, work_size);
+    if (group->last_run[side] != source->run_id) {
+        group->last_run[side] = source->run_id;
+        group->runs[side] = realloc(group->runs[side], (group->run_count[side] + 1) * sizeof(struct sketch *));
+        struct sketch *sketch = malloc(sizeof(struct sketch));
+        if (group->runs[side] == NULL || sketch == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            exit(1);
+        }
+        sketch_init(sketch);
+        group->runs[side][group->run_count[side]++] = sketch;
+    }
+    return group->runs[side][group->run_count[side] - 1];
+}
+
+static void comparison_add_throughput(void *user, const struct result_source *source,
+                                      uint32_t threads, uint64_t work_size, double ops_per_sec) {
+    struct comparison *comparison = user;
+    int side = comparison_side(comparison, source);
+    if (side < 0) {
+        return;
+    }
+
+    struct compare_group *group = comparison_group(comparison, threads, work_size);
+    group->throughput[side] = realloc(group->throughput[side], (group->throughput_count[side] + 1) * sizeof(double));
+    if (group->throughput[side] == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    group->throughput[side][group->throughput_count[side]++] = ops_per_sec;
+}
+
+static int compare_comparison_groups(const void *a, const void *b) {
+    const struct compare_group *x = *(struct compare_group *const *)a;
+    const struct compare_group *y = *(struct compare_group *const *)b;
+    if (x->threads != y->threads) return x->threads < y->threads ? -1 : 1;
+    if (x->work_size != y->work_size) return x->work_size < y->work_size ? -1 : 1;
+    return 0;
+}
+
+// Classifies a relative change from its 95% confidence interval. For latency an increase is a
+// regression, for throughput a decrease.
+static const char *comparison_verdict(double low, double high, double threshold, int higher_is_worse, int significant, int *regressed) {
+    double worse_low = higher_is_worse ? low : -high;
+    double worse_high = higher_is_worse ? high : -low;
+    if (significant && worse_low > threshold) {
+        *regressed = 1;
+        return COLOR_RED "regression" COLOR_RESET;
+    }
+    if (significant && worse_high < -threshold) {
+        return COLOR_GREEN "improvement" COLOR_RESET;
+    }
+    return "no change";
+}
+
+static void comparison_interval(double *changes, int replicates, int stride, int column, double *low, double *high) {
+    double *column_values = malloc(replicates * sizeof(double));
+    for (int r = 0; r < replicates; ++r) {
+        column_values[r] = changes[r * stride + column];
+    }
+    *low = quantile(column_values, replicates, 0.025);
+    *high = quantile(column_values, replicates, 0.975);
+    free(column_values);
+}
+
+// Compares two configurations over all repetitions under data/raw, per thread count and work
+// size. Latency medians and tails are compared with a Mann-Whitney U test and bootstrap
+// intervals of their relative change, throughput through the per-run values. Returns 1 if any
+// statistic regressed by more than the threshold with 95% confidence, 2 on errors.
+int handle_exp_compare(char *name, char *config_a, char *config_b, double threshold, int replicates, int threads) {
+    static const double percentiles[] = { 50.0, 99.0, 99.9 };
+    static const char *percentile_names[] = { "p50", "p99", "p99.9" };
+    const int percentile_count = sizeof(percentiles) / sizeof(percentiles[0]);
+    const double alpha = 0.05;
+    const uint64_t seed = 0x5eed;
+
+    if (strcmp(config_a, config_b) == 0) {
+        LOG_ERROR("Compare two different configurations.\n");
+        return 2;
+    }
+
+    char experiment_path[PATH_MAX];
+    if (find_experiment(name, experiment_path) != 0) {
+        return 2;
+    }
+
+    struct comparison comparison = { .configurations = { config_a, config_b } };
+    if (results_scan_latency(experiment_path, NULL, comparison_select_latency, &comparison) < 0) {
+        LOG_ERROR("No results found in %s/data/raw.\n", experiment_path);
+        return 2;
+    }
+    results_scan_throughput(experiment_path, NULL, comparison_add_throughput, &comparison);
+    qsort(comparison.groups, comparison.count, sizeof(*comparison.groups), compare_comparison_groups);
+
+    LOG_INFO("Comparing '%s' (A) with '%s' (B), regression threshold %.1f%%, %d bootstrap replicates\n\n",
+             config_a, config_b, threshold * 100, replicates);
+    printf("%7s %12s  %-11s %14s %14s %9s %20s  %s\n",
+           "Threads", "Work size", "Statistic", "A", "B", "Change", "95% CI", "Verdict");
+
+    int compared = 0, regressed = 0;
+    double *changes = malloc((size_t)replicates * percentile_count * sizeof(double));
+    for (int i = 0; i < comparison.count; ++i) {
+        struct compare_group *group = comparison.groups[i];
+
+        if (group->run_count[0] > 0 && group->run_count[1] > 0) {
+            struct sample_set sets[2];
+            for (int side = 0; side < 2; ++side) {
+                sample_set_build(&sets[side], group->runs[side], group->run_count[side]);
+            }
+
+            struct mann_whitney test;
+            mann_whitney_sets(&sets[0], &sets[1], &test);
+            bootstrap_percentile_change(&sets[0], &sets[1], percentiles, percentile_count, replicates, threads, seed, changes);
+
+            for (int p = 0; p < percentile_count; ++p) {
+                double a = sample_set_percentile(&sets[0], sets[0].counts, sets[0].total, percentiles[p]) / 1e3;
+                double b = sample_set_percentile(&sets[1], sets[1].counts, sets[1].total, percentiles[p]) / 1e3;
+                double low, high;
+                comparison_interval(changes, replicates, percentile_count, p, &low, &high);
+                const char *verdict = comparison_verdict(low, high, threshold, 1, test.p_value < alpha, &regressed);
+                printf("%7u %12lu  %-11s %11.3f ns %11.3f ns %+8.2f%% [%+7.2f%%, %+7.2f%%]  %s\n",
+                       group->threads, group->work_size, percentile_names[p], a, b,
+                       a > 0 ? (b / a - 1) * 100 : 0, low * 100, high * 100, verdict);
+            }
+            printf("%7s %12s  Mann-Whitney U: p = %.3g, P(B > A) = %.3f over %lu and %lu samples in %d and %d runs\n",
+                   "", "", test.p_value, test.superiority, sets[0].total, sets[1].total,
+                   sets[0].run_count, sets[1].run_count);
+
+            for (int side = 0; side < 2; ++side) {
+                sample_set_free(&sets[side]);
+            }
+            compared++;
+        }
+
+        if (group->throughput_count[0] > 0 && group->throughput_count[1] > 0) {
+            double means[2] = { 0, 0 };
+            for (int side = 0; side < 2; ++side) {
+                for (int r = 0; r < group->throughput_count[side]; ++r) {
+                    means[side] += group->throughput[side][r] / group->throughput_count[side];
+                }
+            }
+
+            struct mann_whitney test;
+            mann_whitney_values(group->throughput[0], group->throughput_count[0],
+                                group->throughput[1], group->throughput_count[1], &test);
+            bootstrap_mean_change(group->throughput[0], group->throughput_count[0],
+                                  group->throughput[1], group->throughput_count[1], replicates, seed, changes);
+            double low, high;
+            comparison_interval(changes, replicates, 1, 0, &low, &high);
+            const char *verdict = comparison_verdict(low, high, threshold, 0, test.p_value < alpha, &regressed);
+            printf("%7u %12lu  %-11s %14.4g %14.4g %+8.2f%% [%+7.2f%%, %+7.2f%%]  %s\n",
+                   group->threads, group->work_size, "ops/s", means[0], means[1],
+                   means[0] > 0 ? (means[1] / means[0] - 1) * 100 : 0, low * 100, high * 100, verdict);
+            printf("%7s %12s  Mann-Whitney U: p = %.3g, P(B > A) = %.3f over %d and %d runs\n",
+                   "", "", test.p_value, test.superiority, group->throughput_count[0], group->throughput_count[1]);
+            compared++;
+        }
+
+        for (int side = 0; side < 2; ++side) {
+            for (int r = 0; r < group->run_count[side]; ++r) {
+                sketch_free(group->runs[side][r]);
+                free(group->runs[side][r]);
+            }
+            free(group->runs[side]);
+            free(group->throughput[side]);
+        }
+        free(group);
+    }
+    free(changes);
+    free(comparison.groups);
+
+    if (compared == 0) {
+        LOG_ERROR("No results that both '%s' and '%s' have in common.\n", config_a, config_b);
+        return 2;
+    }
+    printf("\n");
+    if (regressed) {
+        LOG_ERROR("'%s' regressed against '%s' by more than %.1f%%.\n", config_b, config_a, threshold * 100);
+        return 1;
+    }
+    LOG_SUCCESS("No regression of more than %.1f%%.\n", threshold * 100);
+    return 0;
+}
+
+// Runs of one configuration, thread count and work size in the history store
+struct history_series {
+    const char                  *configuration;
+    uint32_t                     threads;
+    uint64_t                     work_size;
+    const struct history_entry **entries;
+    int                          count;
+};
+
+static int compare_history_entries(const void *a, const void *b) {
+    const struct history_entry *x = *(const struct history_entry *const *)a;
+    const struct history_entry *y = *(const struct history_entry *const *)b;
+    int order = strcmp(x->configuration, y->configuration);
+    if (order != 0) return order;
+    if (x->threads != y->threads) return x->threads < y->threads ? -1 : 1;
+    if (x->work_size != y->work_size) return x->work_size < y->work_size ? -1 : 1;
+    // Runs are ordered by time, run IDs are reused when an experiment is reset
+    order = strcmp(x->started, y->started);
+    if (order != 0) return order;
+    return x->run_id - y->run_id;
+}
+
+static double history_value(const struct history_entry *entry, const char *statistic) {
+    if (strcmp(statistic, "p50") == 0) return entry->p50_ns;
+    if (strcmp(statistic, "p99") == 0) return entry->p99_ns;
+    if (strcmp(statistic, "p99.9") == 0) return entry->p99_9_ns;
+    if (strcmp(statistic, "mean") == 0) return entry->mean_ns;
+    return entry->ops_per_sec;
+}
+
+// Prints the last values of a series as a line of block characters scaled to its range
+static void print_sparkline(const double *values, int count, int width) {
+    static const char *blocks[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+    int start = count > width ? count - width : 0;
+    double low = INFINITY, high = -INFINITY;
+    for (int i = start; i < count; ++i) {
+        if (values[i] < low) low = values[i];
+        if (values[i] > high) high = values[i];
+    }
+    for (int i = start; i < count; ++i) {
+        int level = high > low ? (int)((values[i] - low) / (high - low) * 7 + 0.5) : 3;
+        printf("%s", blocks[level]);
+    }
+    for (int i = count - start; i < width; ++i) {
+        printf(" ");
+    }
+}
+
+static double segment_mean(const double *values, int start, int end) {
+    double sum = 0;
+    for (int i = start; i < end; ++i) {
+        sum += values[i];
+    }
+    return sum / (end - start);
+}
+
+// Shows one series: its trend over all recorded runs and the shifts CUSUM found in it
+static void print_history_series(const struct history_series *series, const char *statistic) {
+    const double threshold = 1.95; // 0.1% false alarms per series without shifts
+    const int sparkline_width = 40;
+    const char *unit = strcmp(statistic, "ops") == 0 ? "ops/s" : "ns";
+
+    double *values = malloc(series->count * sizeof(double));
+    const struct history_entry **entries = malloc(series->count * sizeof(*entries));
+    int *points = malloc(series->count * sizeof(int));
+    if (values == NULL || entries == NULL || points == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    int count = 0;
+    for (int i = 0; i < series->count; ++i) {
+        double value = history_value(series->entries[i], statistic);
+        if (!isnan(value)) {
+            entries[count] = series->entries[i];
+            values[count++] = value;
+        }
+    }
+
+    if (count > 0) {
+        double first = values[0], latest = values[count - 1];
+        printf("%-16.16s %7u %12lu %-6s %5d %14.4g %14.4g %+8.2f%%  ", series->configuration, series->threads,
+               series->work_size, statistic, count, first, latest, first != 0 ? (latest / first - 1) * 100 : 0);
+        print_sparkline(values, count, sparkline_width);
+        printf("\n");
+
+        int found = cusum_change_points(values, count, threshold, points, count);
+        int segment_start = 0;
+        for (int p = 0; p < found; ++p) {
+            int segment_end = p + 1 < found ? points[p + 1] : count;
+            double before = segment_mean(values, segment_start, points[p]);
+            double after = segment_mean(values, points[p], segment_end);
+            const struct history_entry *entry = entries[points[p]];
+            LOG_WARN("%46s change at run %d (%s, commit %.12s): %.4g -> %.4g %s (%+.2f%%)\n", "",
+                     entry->run_id, entry->started[0] ? entry->started : "unknown time",
+                     entry->git_commit[0] ? entry->git_commit : "unknown",
+                     before, after, unit, before != 0 ? (after / before - 1) * 100 : 0);
+            segment_start = points[p];
+        }
+    }
+    free(values);
+    free(entries);
+    free(points);
+}
+
+// Records the runs the history store does not hold yet, then shows how every configuration,
+// thread count and work size has moved over all recorded runs. Returns 1 on errors.
+int handle_exp_history(char *name, char *config_name, char *statistic, int record_only) {
+    static const char *statistics[] = { "p50", "p99", "p99.9", "mean", "ops" };
+    if (statistic != NULL) {
+        size_t i = 0;
+        while (i < sizeof(statistics) / sizeof(statistics[0]) && strcmp(statistic, statistics[i]) != 0) {
+            i++;
+        }
+        if (i == sizeof(statistics) / sizeof(statistics[0])) {
+            LOG_ERROR("Unknown statistic '%s', expected one of p50, p99, p99.9, mean or ops.\n", statistic);
+            return 1;
+        }
+    }
+
+    char experiment_path[PATH_MAX];
+    if (find_experiment(name, experiment_path) != 0) {
+        return 1;
+    }
+
+    int recorded = history_record(experiment_path);
+    if (recorded < 0) {
+        return 1;
+    }
+    if (record_only) {
+        LOG_SUCCESS("Recorded %d new result%s in %s/" HISTORY_FILE ".\n", recorded, recorded == 1 ? "" : "s", experiment_path);
+        return 0;
+    }
+
+    struct history history;
+    if (history_load(experiment_path, &history) != 0 || history.count == 0) {
+        LOG_ERROR("No completed runs recorded for '%s' yet.\n", name);
+        history_free(&history);
+        return 1;
+    }
+
+    const struct history_entry **entries = malloc(history.count * sizeof(*entries));
+    if (entries == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    int count = 0;
+    for (int i = 0; i < history.count; ++i) {
+        if (config_name == NULL || strcmp(history.entries[i].configuration, config_name) == 0) {
+            entries[count++] = &history.entries[i];
+        }
+    }
+    qsort(entries, count, sizeof(*entries), compare_history_entries);
+
+    if (recorded > 0) {
+        LOG_INFO("Recorded %d new result%s.\n", recorded, recorded == 1 ? "" : "s");
+    }
+    if (count == 0) {
+        LOG_WARN("No recorded runs of configuration '%s'.\n", config_name);
+        free(entries);
+        history_free(&history);
+        return 0;
+    }
+
+    printf("%-16s %7s %12s %-6s %5s %14s %14s %9s  %s\n",
+           "Configuration", "Threads", "Work size", "Stat", "Runs", "First", "Latest", "Change", "Trend (oldest to latest)");
+    for (int start = 0; start < count;) {
+        struct history_series series = {
+            .configuration = entries[start]->configuration,
+            .threads = entries[start]->threads,
+            .work_size = entries[start]->work_size,
+            .entries = &entries[start],
+        };
+        int has_latency = 0;
+        while (start + series.count < count &&
+               entries[start + series.count]->threads == series.threads &&
+               entries[start + series.count]->work_size == series.work_size &&
+               strcmp(entries[start + series.count]->configuration, series.configuration) == 0) {
+            has_latency |= !isnan(entries[start + series.count]->p50_ns);
+            series.count++;
+        }
+
+        print_history_series(&series, statistic ? statistic : has_latency ? "p50" : "ops");
+        start += series.count;
+    }
+
+    free(entries);
+    history_free(&history);
+    return 0;
 }
 
 void handle_sysinfo() {
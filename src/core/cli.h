@@ -21,6 +21,6 @@
 #define LOG_INFO(fmt, ...)  printf(COLOR_CYAN fmt COLOR_RESET, ##__VA_ARGS__)
 #define LOG_SUCCESS(fmt, ...) printf(COLOR_GREEN fmt COLOR_RESET, ##__VA_ARGS__)
 
-void cli_main(int argc, char **argv);
+int cli_main(int argc, char **argv);
 
 #endif // CLI_H
@@ -0,0 +1,419 @@
+#define _GNU_SOURCE
+#include "history.h"
+#include "results.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+// Manifest fields copied into every row of a run, as section and key
+static const char *const manifest_fields[][2] = {
+    { "run",     "started" },
+    { "run",     "finished" },
+    { "run",     "hostname" },
+    { "machine", "cpu_model" },
+    { "machine", "microcode" },
+    { "machine", "kernel" },
+    { "machine", "governor" },
+    { "machine", "turbo" },
+    { "build",   "compiler" },
+    { "build",   "expconfig" },
+    { "build",   "source_hash" },
+    { "source",  "git_commit" },
+};
+#define MANIFEST_FIELD_COUNT (int)(sizeof(manifest_fields) / sizeof(manifest_fields[0]))
+#define MANIFEST_STARTED     0
+
+static const char *const summary_columns[] = {
+    "threads", "work_size", "samples", "mean_ns", "p50_ns", "p99_ns", "p99_9_ns", "ops_per_sec",
+};
+
+struct manifest {
+    char values[MANIFEST_FIELD_COUNT][256];
+    int  exit_status;
+};
+
+static void *checked_realloc(void *pointer, size_t size) {
+    pointer = realloc(pointer, size);
+    if (pointer == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    return pointer;
+}
+
+// Reads the fields of a run's manifest.ini, returns -1 if the run has none
+static int read_manifest(const char *directory, struct manifest *manifest) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.4000s/manifest.ini", directory);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    memset(manifest, 0, sizeof(*manifest));
+    manifest->exit_status = -1;
+    char line[4096], section[64] = "";
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '[') {
+            snprintf(section, sizeof(section), "%.*s", (int)strcspn(line + 1, "]"), line + 1);
+            continue;
+        }
+        char *separator = strstr(line, " = ");
+        if (separator == NULL) {
+            continue;
+        }
+        *separator = '\0';
+        const char *value = separator + 3;
+
+        if (strcmp(section, "run") == 0 && strcmp(line, "exit_status") == 0) {
+            manifest->exit_status = atoi(value);
+        }
+        for (int i = 0; i < MANIFEST_FIELD_COUNT; ++i) {
+            if (strcmp(section, manifest_fields[i][0]) == 0 && strcmp(line, manifest_fields[i][1]) == 0) {
+                snprintf(manifest->values[i], sizeof(manifest->values[i]), "%s", value);
+                // Values end up in a tab separated file
+                for (char *c = manifest->values[i]; *c; ++c) {
+                    if (*c == '\t') *c = ' ';
+                }
+            }
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+// Splits a row of the store in place. Empty fields are kept, unlike with strtok.
+static int split_row(char *line, char **fields, int max_fields) {
+    line[strcspn(line, "\r\n")] = '\0';
+    int count = 0;
+    char *field;
+    while (count < max_fields && (field = strsep(&line, "\t")) != NULL) {
+        fields[count++] = field;
+    }
+    return count;
+}
+
+static int column_index(char **header, int count, const char *name) {
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(header[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#define HISTORY_MAX_COLUMNS 64
+
+// A row of the store that identifies one run of a configuration
+struct history_key {
+    int   run_id;
+    char *configuration;
+    char *started;
+};
+
+// Results of one thread count and work size of the run being recorded
+struct run_group {
+    uint32_t      threads;
+    uint64_t      work_size;
+    struct sketch latency;
+    double        ops_sum;
+    int           ops_count;
+};
+
+struct history_recorder {
+    FILE                *file;
+    char                 recorded[32];
+    struct history_key  *keys;
+    int                  key_count;
+    struct run_group   **groups;
+    int                  group_count;
+    int                  rows;
+};
+
+static void read_keys(struct history_recorder *recorder) {
+    char *line = NULL;
+    size_t capacity = 0;
+    char *fields[HISTORY_MAX_COLUMNS];
+    int run_column = -1, configuration_column = -1, started_column = -1;
+
+    rewind(recorder->file);
+    if (getline(&line, &capacity, recorder->file) > 0) {
+        int count = split_row(line, fields, HISTORY_MAX_COLUMNS);
+        run_column = column_index(fields, count, "run_id");
+        configuration_column = column_index(fields, count, "configuration");
+        started_column = column_index(fields, count, "started");
+    }
+    while (run_column >= 0 && configuration_column >= 0 && started_column >= 0 &&
+           getline(&line, &capacity, recorder->file) > 0) {
+        int count = split_row(line, fields, HISTORY_MAX_COLUMNS);
+        if (count <= run_column || count <= configuration_column || count <= started_column) {
+            continue;
+        }
+
+        // Rows of one run are adjacent, one key covers all of them
+        int run_id = atoi(fields[run_column]);
+        if (recorder->key_count > 0) {
+            struct history_key *last = &recorder->keys[recorder->key_count - 1];
+            if (last->run_id == run_id && strcmp(last->configuration, fields[configuration_column]) == 0 &&
+                strcmp(last->started, fields[started_column]) == 0) {
+                continue;
+            }
+        }
+        recorder->keys = checked_realloc(recorder->keys, (recorder->key_count + 1) * sizeof(struct history_key));
+        recorder->keys[recorder->key_count++] = (struct history_key) {
+            .run_id = run_id,
+            .configuration = strdup(fields[configuration_column]),
+            .started = strdup(fields[started_column]),
+        };
+    }
+    free(line);
+}
+
+static int is_recorded(const struct history_recorder *recorder, int run_id, const char *configuration, const char *started) {
+    for (int i = recorder->key_count - 1; i >= 0; --i) {
+        const struct history_key *key = &recorder->keys[i];
+        if (key->run_id == run_id && strcmp(key->configuration, configuration) == 0 && strcmp(key->started, started) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static struct run_group *run_group(struct history_recorder *recorder, uint32_t threads, uint64_t work_size) {
+    for (int i = recorder->group_count - 1; i >= 0; --i) {
+        if (recorder->groups[i]->threads == threads && recorder->groups[i]->work_size == work_size) {
+            return recorder->groups[i];
+        }
+    }
+
+    struct run_group *group = calloc(1, sizeof(*group));
+    if (group == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    group->threads = threads;
+    group->work_size = work_size;
+    sketch_init(&group->latency);
+    recorder->groups = checked_realloc(recorder->groups, (recorder->group_count + 1) * sizeof(*recorder->groups));
+    recorder->groups[recorder->group_count++] = group;
+    return group;
+}
+
+static struct sketch *recorder_select_latency(void *user, const struct result_source *source,
+                                              uint32_t threads, uint64_t work_size) {
+    return &run_group(user, threads, work_size)->latency;
+}
+
+static void recorder_add_throughput(void *user, const struct result_source *source,
+                                    uint32_t threads, uint64_t work_size, double ops_per_sec) {
+    struct run_group *group = run_group(user, threads, work_size);
+    group->ops_sum += ops_per_sec;
+    group->ops_count++;
+}
+
+static int compare_run_groups(const void *a, const void *b) {
+    const struct run_group *x = *(struct run_group *const *)a;
+    const struct run_group *y = *(struct run_group *const *)b;
+    if (x->threads != y->threads) return x->threads < y->threads ? -1 : 1;
+    if (x->work_size != y->work_size) return x->work_size < y->work_size ? -1 : 1;
+    return 0;
+}
+
+static void write_optional(FILE *file, int present, double value) {
+    if (present) {
+        fprintf(file, "\t%.3f", value);
+    } else {
+        fprintf(file, "\t");
+    }
+}
+
+// Summarizes one run directory and appends its rows, unless it failed, is still running
+// (its manifest is written once it finishes) or is already in the store
+static int record_run(const char *directory, const struct result_source *source, void *user) {
+    struct history_recorder *recorder = user;
+    struct manifest manifest;
+    if (read_manifest(directory, &manifest) != 0 || manifest.exit_status != 0 ||
+        is_recorded(recorder, source->run_id, source->configuration, manifest.values[MANIFEST_STARTED])) {
+        return 0;
+    }
+
+    recorder->group_count = 0;
+    results_scan_run_latency(directory, source, recorder_select_latency, recorder);
+    results_scan_run_throughput(directory, source, recorder_add_throughput, recorder);
+    qsort(recorder->groups, recorder->group_count, sizeof(*recorder->groups), compare_run_groups);
+
+    for (int i = 0; i < recorder->group_count; ++i) {
+        struct run_group *group = recorder->groups[i];
+        struct sketch *latency = &group->latency;
+
+        fprintf(recorder->file, "%s\t%d\t%s", recorder->recorded, source->run_id, source->configuration);
+        for (int field = 0; field < MANIFEST_FIELD_COUNT; ++field) {
+            fprintf(recorder->file, "\t%s", manifest.values[field]);
+        }
+        fprintf(recorder->file, "\t%u\t%lu\t%lu", group->threads, group->work_size, latency->count);
+        write_optional(recorder->file, latency->count > 0, sketch_to_ns(latency, sketch_mean(latency)));
+        write_optional(recorder->file, latency->count > 0, sketch_to_ns(latency, sketch_percentile(latency, 50.0)));
+        write_optional(recorder->file, latency->count > 0, sketch_to_ns(latency, sketch_percentile(latency, 99.0)));
+        write_optional(recorder->file, latency->count > 0, sketch_to_ns(latency, sketch_percentile(latency, 99.9)));
+        write_optional(recorder->file, group->ops_count > 0, group->ops_count ? group->ops_sum / group->ops_count : 0);
+        fprintf(recorder->file, "\n");
+        recorder->rows++;
+
+        sketch_free(latency);
+        free(group);
+    }
+    return recorder->group_count > 0;
+}
+
+int history_record(const char *experiment_path) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.4000s/data/raw", experiment_path);
+    if (access(path, F_OK) != 0) {
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%.4000s/" HISTORY_FILE, experiment_path);
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) {
+        perror("Failed to open the history store");
+        return -1;
+    }
+    // Concurrent runs of the same experiment append one after the other
+    if (flock(fd, LOCK_EX) != 0) {
+        perror("Failed to lock the history store");
+        close(fd);
+        return -1;
+    }
+    struct history_recorder recorder = { .file = fdopen(fd, "a+") };
+    if (recorder.file == NULL) {
+        perror("Failed to open the history store");
+        close(fd);
+        return -1;
+    }
+
+    time_t now = time(NULL);
+    strftime(recorder.recorded, sizeof(recorder.recorded), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    read_keys(&recorder);
+    fseek(recorder.file, 0, SEEK_END);
+    if (ftell(recorder.file) == 0) {
+        fprintf(recorder.file, "recorded\trun_id\tconfiguration");
+        for (int field = 0; field < MANIFEST_FIELD_COUNT; ++field) {
+            fprintf(recorder.file, "\t%s", manifest_fields[field][1]);
+        }
+        for (size_t column = 0; column < sizeof(summary_columns) / sizeof(summary_columns[0]); ++column) {
+            fprintf(recorder.file, "\t%s", summary_columns[column]);
+        }
+        fprintf(recorder.file, "\n");
+    }
+
+    results_for_each_run(experiment_path, NULL, record_run, &recorder);
+
+    int status = fflush(recorder.file) == 0 ? recorder.rows : -1;
+    if (status < 0) {
+        perror("Failed to write the history store");
+    }
+    fclose(recorder.file); // Releases the lock
+    for (int i = 0; i < recorder.key_count; ++i) {
+        free(recorder.keys[i].configuration);
+        free(recorder.keys[i].started);
+    }
+    free(recorder.keys);
+    free(recorder.groups);
+    return status;
+}
+
+static double parse_optional(char **fields, int count, int column) {
+    if (column < 0 || column >= count || fields[column][0] == '\0') {
+        return NAN;
+    }
+    return strtod(fields[column], NULL);
+}
+
+int history_load(const char *experiment_path, struct history *history) {
+    memset(history, 0, sizeof(*history));
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.4000s/" HISTORY_FILE, experiment_path);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    char *fields[HISTORY_MAX_COLUMNS];
+    if (getline(&line, &capacity, file) <= 0) {
+        free(line);
+        fclose(file);
+        return -1;
+    }
+    int count = split_row(line, fields, HISTORY_MAX_COLUMNS);
+    int run_column = column_index(fields, count, "run_id");
+    int configuration_column = column_index(fields, count, "configuration");
+    int started_column = column_index(fields, count, "started");
+    int commit_column = column_index(fields, count, "git_commit");
+    int threads_column = column_index(fields, count, "threads");
+    int work_size_column = column_index(fields, count, "work_size");
+    int samples_column = column_index(fields, count, "samples");
+    int mean_column = column_index(fields, count, "mean_ns");
+    int p50_column = column_index(fields, count, "p50_ns");
+    int p99_column = column_index(fields, count, "p99_ns");
+    int p99_9_column = column_index(fields, count, "p99_9_ns");
+    int ops_column = column_index(fields, count, "ops_per_sec");
+    if (run_column < 0 || configuration_column < 0 || threads_column < 0 || work_size_column < 0) {
+        fprintf(stderr, "Error: %s is not a history store.\n", path);
+        free(line);
+        fclose(file);
+        return -1;
+    }
+
+    int allocated = 0;
+    while (getline(&line, &capacity, file) > 0) {
+        count = split_row(line, fields, HISTORY_MAX_COLUMNS);
+        if (count <= run_column || count <= configuration_column || count <= threads_column || count <= work_size_column) {
+            continue;
+        }
+        if (history->count == allocated) {
+            allocated = allocated ? allocated * 2 : 256;
+            history->entries = checked_realloc(history->entries, allocated * sizeof(struct history_entry));
+        }
+
+        struct history_entry *entry = &history->entries[history->count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->run_id = atoi(fields[run_column]);
+        snprintf(entry->configuration, sizeof(entry->configuration), "%s", fields[configuration_column]);
+        if (started_column >= 0 && started_column < count) {
+            snprintf(entry->started, sizeof(entry->started), "%s", fields[started_column]);
+        }
+        if (commit_column >= 0 && commit_column < count) {
+            snprintf(entry->git_commit, sizeof(entry->git_commit), "%s", fields[commit_column]);
+        }
+        entry->threads = (uint32_t)strtoul(fields[threads_column], NULL, 10);
+        entry->work_size = strtoull(fields[work_size_column], NULL, 10);
+        if (samples_column >= 0 && samples_column < count) {
+            entry->samples = strtoull(fields[samples_column], NULL, 10);
+        }
+        entry->mean_ns = parse_optional(fields, count, mean_column);
+        entry->p50_ns = parse_optional(fields, count, p50_column);
+        entry->p99_ns = parse_optional(fields, count, p99_column);
+        entry->p99_9_ns = parse_optional(fields, count, p99_9_column);
+        entry->ops_per_sec = parse_optional(fields, count, ops_column);
+    }
+    free(line);
+    fclose(file);
+    return 0;
+}
+
+void history_free(struct history *history) {
+    free(history->entries);
+    history->entries = NULL;
+    history->count = 0;
+}
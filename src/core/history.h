@@ -0,0 +1,41 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+#include <stdint.h>
+
+// Append-only store of run summaries, <experiment>/data/history.tsv. Every completed run adds
+// one row per configuration, thread count and work size with its latency and throughput
+// summary and the machine, build and source fields of its manifest. Rows are never rewritten,
+// so results outlive the run directories they came from and the file is safe to commit.
+#define HISTORY_FILE "data/history.tsv"
+
+struct history_entry {
+    int      run_id;
+    char     configuration[256];
+    char     started[64];
+    char     git_commit[64];
+    uint32_t threads;
+    uint64_t work_size;
+    uint64_t samples;
+    double   mean_ns;           // NAN when the run recorded no latency, likewise for the others
+    double   p50_ns;
+    double   p99_ns;
+    double   p99_9_ns;
+    double   ops_per_sec;
+};
+
+struct history {
+    struct history_entry *entries;
+    int                   count;
+};
+
+// Adds the summaries of every completed run under data/raw that the store does not hold yet.
+// A run is identified by its ID, configuration and start time, so reused run IDs are kept
+// apart. Returns the number of rows appended, or -1 if the store cannot be written.
+int history_record(const char *experiment_path);
+
+// Reads the store, returns 0 on success. Columns are looked up by name, so stores written
+// by older versions stay readable.
+int history_load(const char *experiment_path, struct history *history);
+void history_free(struct history *history);
+
+#endif // HISTORY_H
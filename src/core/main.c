@@ -1,7 +1,6 @@
 #include "cli.h"
 
 int main(int argc, char **argv) {
-    cli_main(argc, argv);
-    return 0;
+    return cli_main(argc, argv);
 }
 
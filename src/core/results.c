@@ -0,0 +1,595 @@
+#define _GNU_SOURCE
+#include "results.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define COLUMNAR_MAGIC  "APXCOL01"
+#define COLUMNAR_U32    1
+#define COLUMNAR_U64    2
+#define COLUMNAR_RLE    1
+
+// Layout of the binary result files written by the benchmark template
+struct columnar_file_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t column_count;
+    uint64_t row_count;
+    uint8_t  reserved[40];
+};
+
+struct columnar_column_header {
+    char     name[32];
+    uint32_t type;
+    uint32_t encoding;
+    uint64_t offset;
+    uint64_t length;
+    uint64_t reserved;
+};
+
+struct columnar_run {
+    uint64_t value;
+    uint64_t count;
+};
+
+struct histogram_record_header {
+    uint32_t threads;
+    uint32_t thread_id;
+    uint64_t work_size;
+    uint64_t total_count;
+    uint64_t min;
+    uint64_t max;
+    uint32_t significant_digits;
+    uint32_t sub_bucket_half_count_magnitude;
+    uint32_t bucket_count;
+    uint32_t nonzero_count;
+};
+
+void sketch_init(struct sketch *sketch) {
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->min = UINT64_MAX;
+}
+
+void sketch_free(struct sketch *sketch) {
+    for (int i = 0; i < SKETCH_CHUNK_COUNT; ++i) {
+        free(sketch->chunks[i]);
+    }
+    sketch_init(sketch);
+}
+
+uint64_t *sketch_allocate_chunk(struct sketch *sketch, int chunk) {
+    sketch->chunks[chunk] = calloc(SKETCH_SUB_BUCKET_HALF_COUNT, sizeof(uint64_t));
+    if (sketch->chunks[chunk] == NULL) {
+        fprintf(stderr, "Error: Failed to allocate a latency sketch.\n");
+        exit(1);
+    }
+    return sketch->chunks[chunk];
+}
+
+// Highest value that falls into the same sub-bucket as the given counts index, the value the
+// template's histogram reports, so that percentiles match the benchmark's own summary
+uint64_t sketch_value_at_index(int index) {
+    int bucket_index = (index >> SKETCH_SUB_BUCKET_HALF_MAGNITUDE) - 1;
+    int sub_bucket_index = (index & (SKETCH_SUB_BUCKET_HALF_COUNT - 1)) + SKETCH_SUB_BUCKET_HALF_COUNT;
+    if (bucket_index < 0) {
+        sub_bucket_index -= SKETCH_SUB_BUCKET_HALF_COUNT;
+        bucket_index = 0;
+    }
+    return ((uint64_t)sub_bucket_index << bucket_index) + (1ULL << bucket_index) - 1;
+}
+
+void sketch_merge(struct sketch *into, const struct sketch *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->unit_ps == 0) {
+        into->unit_ps = from->unit_ps;
+    }
+
+    // Sketches of different units are merged bucket by bucket at the cost of their precision
+    if (into->unit_ps != from->unit_ps) {
+        for (int i = 0; i < SKETCH_CHUNK_COUNT; ++i) {
+            for (int j = 0; from->chunks[i] && j < SKETCH_SUB_BUCKET_HALF_COUNT; ++j) {
+                if (from->chunks[i][j]) {
+                    uint64_t value = sketch_value_at_index((i << SKETCH_SUB_BUCKET_HALF_MAGNITUDE) + j);
+                    sketch_record_n(into, value * from->unit_ps / into->unit_ps, from->chunks[i][j]);
+                }
+            }
+        }
+        return;
+    }
+
+    if (into->count == 0) {
+        into->shift = from->shift;
+    }
+
+    // Move the sums of the other sketch to this sketch's shift
+    double offset = (double)from->shift - (double)into->shift;
+    into->sum += from->sum + offset * from->count;
+    into->sum_squares += from->sum_squares + 2 * offset * from->sum + offset * offset * from->count;
+    into->count += from->count;
+    if (from->min < into->min) into->min = from->min;
+    if (from->max > into->max) into->max = from->max;
+
+    for (int i = 0; i < SKETCH_CHUNK_COUNT; ++i) {
+        if (from->chunks[i] == NULL) {
+            continue;
+        }
+        uint64_t *counts = into->chunks[i] ? into->chunks[i] : sketch_allocate_chunk(into, i);
+        for (int j = 0; j < SKETCH_SUB_BUCKET_HALF_COUNT; ++j) {
+            counts[j] += from->chunks[i][j];
+        }
+    }
+}
+
+double sketch_mean(const struct sketch *sketch) {
+    return sketch->count ? sketch->shift + sketch->sum / sketch->count : 0;
+}
+
+double sketch_stddev(const struct sketch *sketch) {
+    if (sketch->count < 2) {
+        return 0;
+    }
+    double variance = (sketch->sum_squares - sketch->sum * sketch->sum / sketch->count) / (sketch->count - 1);
+    return variance > 0 ? sqrt(variance) : 0;
+}
+
+uint64_t sketch_percentile(const struct sketch *sketch, double percentile) {
+    if (sketch->count == 0) {
+        return 0;
+    }
+    uint64_t count_at_percentile = (uint64_t)(percentile / 100.0 * sketch->count + 0.5);
+    if (count_at_percentile < 1) {
+        count_at_percentile = 1;
+    }
+
+    uint64_t running_count = 0;
+    for (int i = 0; i < SKETCH_CHUNK_COUNT; ++i) {
+        if (sketch->chunks[i] == NULL) {
+            continue;
+        }
+        for (int j = 0; j < SKETCH_SUB_BUCKET_HALF_COUNT; ++j) {
+            running_count += sketch->chunks[i][j];
+            if (running_count >= count_at_percentile) {
+                uint64_t value = sketch_value_at_index((i << SKETCH_SUB_BUCKET_HALF_MAGNITUDE) + j);
+                if (value > sketch->max) value = sketch->max;
+                return value < sketch->min ? sketch->min : value;
+            }
+        }
+    }
+    return sketch->max;
+}
+
+double sketch_to_ns(const struct sketch *sketch, double value) {
+    return value * sketch->unit_ps / 1e3;
+}
+
+// Caches the sketch of the last thread count and work size, rows of one group are contiguous
+struct select_cache {
+    result_select_fn     select;
+    void                *user;
+    struct result_source source;
+    uint32_t             unit_ps;       // Unit of the file being scanned
+    int                  valid;
+    uint32_t             threads;
+    uint64_t             work_size;
+    struct sketch       *sketch;
+};
+
+static inline struct sketch *select_sketch(struct select_cache *cache, uint32_t threads, uint64_t work_size) {
+    if (!cache->valid || cache->threads != threads || cache->work_size != work_size) {
+        cache->sketch = cache->select(cache->user, &cache->source, threads, work_size);
+        cache->threads = threads;
+        cache->work_size = work_size;
+        cache->valid = 1;
+        if (cache->sketch && cache->sketch->unit_ps == 0) {
+            cache->sketch->unit_ps = cache->unit_ps;
+        }
+    }
+    return cache->sketch;
+}
+
+// Converts a value of the scanned file to the unit of the selected sketch
+static inline uint64_t sketch_units(const struct select_cache *cache, uint64_t value) {
+    return cache->unit_ps == cache->sketch->unit_ps ? value : value * cache->unit_ps / cache->sketch->unit_ps;
+}
+
+// Reads latencies.bin. The threads and work size columns are run-length encoded, so the
+// plain latency column is consumed in segments over which both stay constant.
+static int scan_columnar(const char *path, struct select_cache *cache) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct columnar_file_header)) {
+        close(fd);
+        return 0;
+    }
+    const uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+    const struct columnar_file_header *header = (const void *)data;
+    const struct columnar_column_header *columns = (const void *)(header + 1);
+    const struct columnar_run *threads = NULL, *work_sizes = NULL;
+    uint64_t threads_runs = 0, work_size_runs = 0;
+    const uint64_t *latencies = NULL;
+
+    int valid = memcmp(header->magic, COLUMNAR_MAGIC, 8) == 0 &&
+                sizeof(*header) + header->column_count * sizeof(*columns) <= (size_t)st.st_size;
+    for (uint32_t i = 0; valid && i < header->column_count; ++i) {
+        const struct columnar_column_header *column = &columns[i];
+        size_t width = column->encoding == COLUMNAR_RLE ? sizeof(struct columnar_run) :
+                       column->type == COLUMNAR_U32 ? sizeof(uint32_t) : sizeof(uint64_t);
+        size_t size = column->length * width;
+        if (column->offset + size > (uint64_t)st.st_size) {
+            valid = 0;
+        } else if (strcmp(column->name, "threads") == 0 && column->encoding == COLUMNAR_RLE) {
+            threads = (const void *)(data + column->offset);
+            threads_runs = column->length;
+        } else if (strcmp(column->name, "work_size") == 0 && column->encoding == COLUMNAR_RLE) {
+            work_sizes = (const void *)(data + column->offset);
+            work_size_runs = column->length;
+        } else if (strncmp(column->name, "latency", 7) == 0 && column->type == COLUMNAR_U64 && column->length == header->row_count) {
+            latencies = (const void *)(data + column->offset);
+            cache->unit_ps = strcmp(column->name, "latency_ps") == 0 ? 1 : 1000;
+        }
+    }
+    if (!valid || latencies == NULL || work_sizes == NULL) {
+        fprintf(stderr, "Warning: Skipping unreadable result file %s\n", path);
+        munmap((void *)data, st.st_size);
+        return 0;
+    }
+
+    uint64_t row = 0, threads_end = 0, work_size_end = 0;
+    uint64_t t = 0, w = 0;
+    uint32_t thread_count = 1;
+    uint64_t work_size = 0;
+    while (row < header->row_count) {
+        if (row == work_size_end) {
+            if (w == work_size_runs) break;
+            work_size = work_sizes[w].value;
+            work_size_end += work_sizes[w++].count;
+        }
+        if (threads && row == threads_end) {
+            if (t == threads_runs) break;
+            thread_count = (uint32_t)threads[t].value;
+            threads_end += threads[t++].count;
+        }
+
+        uint64_t end = work_size_end;
+        if (threads && threads_end < end) end = threads_end;
+        if (end > header->row_count) end = header->row_count;
+
+        struct sketch *sketch = select_sketch(cache, thread_count, work_size);
+        if (sketch) {
+            for (; row < end; ++row) {
+                sketch_record(sketch, sketch_units(cache, latencies[row]));
+            }
+        }
+        row = end;
+    }
+
+    munmap((void *)data, st.st_size);
+    return 1;
+}
+
+// Finds the index of a column in a CSV header line, or -1
+static int csv_column(const char *header, const char *name) {
+    size_t length = strlen(name);
+    int index = 0;
+    for (const char *p = header; *p; ++index) {
+        const char *end = p + strcspn(p, ",\r\n");
+        if ((size_t)(end - p) == length && strncmp(p, name, length) == 0) {
+            return index;
+        }
+        if (*end != ',') break;
+        p = end + 1;
+    }
+    return -1;
+}
+
+// Splits a CSV line in place into at most max_fields fields, returns the field count
+static int csv_split(char *line, char **fields, int max_fields) {
+    int count = 0;
+    char *p = line;
+    while (count < max_fields) {
+        fields[count++] = p;
+        p += strcspn(p, ",\r\n");
+        if (*p != ',') {
+            *p = '\0';
+            break;
+        }
+        *p++ = '\0';
+    }
+    return count;
+}
+
+#define CSV_MAX_FIELDS 16
+
+// Reads latencies.csv. Every field of the raw sample files is an unsigned integer, so rows
+// are parsed straight from the mapped file instead of going through stdio and strtoull.
+static int scan_latency_csv(const char *path, struct select_cache *cache) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+    const char *end = data + st.st_size;
+
+    char header[1024];
+    const char *p = memchr(data, '\n', st.st_size);
+    size_t header_length = p ? (size_t)(p - data) : (size_t)st.st_size;
+    if (header_length >= sizeof(header)) header_length = sizeof(header) - 1;
+    memcpy(header, data, header_length);
+    header[header_length] = '\0';
+
+    int threads_column = csv_column(header, "threads");
+    int work_size_column = csv_column(header, "work_size");
+    int latency_column = csv_column(header, "latency");
+    cache->unit_ps = 1000;
+    if (latency_column < 0) {
+        latency_column = csv_column(header, "latency_ps");
+        cache->unit_ps = 1;
+    }
+    if (latency_column < 0 || work_size_column < 0 || latency_column >= CSV_MAX_FIELDS ||
+        work_size_column >= CSV_MAX_FIELDS || threads_column >= CSV_MAX_FIELDS) {
+        fprintf(stderr, "Warning: Skipping unreadable result file %s\n", path);
+        munmap((void *)data, st.st_size);
+        return 0;
+    }
+    int last_column = latency_column > work_size_column ? latency_column : work_size_column;
+    if (threads_column > last_column) last_column = threads_column;
+
+    uint64_t fields[CSV_MAX_FIELDS] = { 0 };
+    int field = 0;
+    for (p = p ? p + 1 : end; p < end; ++p) {
+        char c = *p;
+        if (c >= '0' && c <= '9') {
+            if (field < CSV_MAX_FIELDS) fields[field] = fields[field] * 10 + (uint64_t)(c - '0');
+        } else if (c == ',') {
+            field++;
+        } else if (c == '\n') {
+            if (field >= last_column) {
+                uint32_t threads = threads_column >= 0 ? (uint32_t)fields[threads_column] : 1;
+                struct sketch *sketch = select_sketch(cache, threads, fields[work_size_column]);
+                if (sketch) {
+                    sketch_record(sketch, sketch_units(cache, fields[latency_column]));
+                }
+            }
+            memset(fields, 0, sizeof(fields));
+            field = 0;
+        }
+    }
+
+    munmap((void *)data, st.st_size);
+    return 1;
+}
+
+// Merges the histograms of latency_histogram.bin. Every bucket is recorded at the highest
+// value of its range, like sketch_value_at_index, clamped to the histogram's exact minimum and maximum.
+static int scan_histogram(const char *path, struct select_cache *cache) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char magic[8];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        (memcmp(magic, "APXHIST1", 8) != 0 && memcmp(magic, "APXHISTP", 8) != 0)) {
+        fprintf(stderr, "Warning: Skipping unreadable result file %s\n", path);
+        fclose(file);
+        return 0;
+    }
+    cache->unit_ps = memcmp(magic, "APXHISTP", 8) == 0 ? 1 : 1000;
+
+    struct histogram_record_header header;
+    uint32_t *indices = NULL;
+    uint64_t *counts = NULL;
+    size_t capacity = 0;
+    while (fread(&header, sizeof(header), 1, file) == 1) {
+        if (header.nonzero_count > capacity) {
+            capacity = header.nonzero_count;
+            indices = realloc(indices, capacity * sizeof(uint32_t));
+            counts = realloc(counts, capacity * sizeof(uint64_t));
+            if (indices == NULL || counts == NULL) {
+                fprintf(stderr, "Error: Failed to allocate memory for %s\n", path);
+                exit(1);
+            }
+        }
+        if (fread(indices, sizeof(uint32_t), header.nonzero_count, file) != header.nonzero_count ||
+            fread(counts, sizeof(uint64_t), header.nonzero_count, file) != header.nonzero_count ||
+            header.sub_bucket_half_count_magnitude >= 32) {
+            fprintf(stderr, "Warning: Truncated histogram in %s\n", path);
+            break;
+        }
+
+        struct sketch *sketch = select_sketch(cache, header.threads ? header.threads : 1, header.work_size);
+        if (sketch == NULL) {
+            continue;
+        }
+
+        int magnitude = (int)header.sub_bucket_half_count_magnitude;
+        uint64_t half_count = 1ULL << magnitude;
+        for (uint32_t i = 0; i < header.nonzero_count; ++i) {
+            int bucket_index = (int)(indices[i] >> magnitude) - 1;
+            uint64_t sub_bucket_index = (indices[i] & (half_count - 1)) + half_count;
+            if (bucket_index < 0) {
+                sub_bucket_index -= half_count;
+                bucket_index = 0;
+            }
+            uint64_t value = (sub_bucket_index << bucket_index) + (1ULL << bucket_index) - 1;
+            if (value < header.min) value = header.min;
+            if (value > header.max) value = header.max;
+            sketch_record_n(sketch, sketch_units(cache, value), counts[i]);
+        }
+    }
+
+    free(indices);
+    free(counts);
+    fclose(file);
+    return 1;
+}
+
+static int select_runs(const struct dirent *entry) {
+    int id;
+    char end;
+    return entry->d_type == DT_DIR && sscanf(entry->d_name, "run_%d%c", &id, &end) == 1;
+}
+
+static int select_configurations(const struct dirent *entry) {
+    return entry->d_type == DT_DIR && entry->d_name[0] != '.';
+}
+
+int results_for_each_run(const char *experiment_path, const char *configuration,
+                         result_run_fn scan, void *state) {
+    char raw_path[PATH_MAX];
+    snprintf(raw_path, sizeof(raw_path), "%s/data/raw", experiment_path);
+
+    struct dirent **runs;
+    int run_count = scandir(raw_path, &runs, select_runs, versionsort);
+    if (run_count < 0) {
+        return -1;
+    }
+
+    int files = 0;
+    for (int i = 0; i < run_count; ++i) {
+        char run_path[PATH_MAX];
+        snprintf(run_path, sizeof(run_path), "%.3800s/%.255s", raw_path, runs[i]->d_name);
+
+        struct dirent **configurations;
+        int count = scandir(run_path, &configurations, select_configurations, alphasort);
+        for (int j = 0; j < count; ++j) {
+            if (configuration == NULL || strcmp(configuration, configurations[j]->d_name) == 0) {
+                char directory[PATH_MAX];
+                snprintf(directory, sizeof(directory), "%.3800s/%.255s", run_path, configurations[j]->d_name);
+                struct result_source source = {
+                    .configuration = configurations[j]->d_name,
+                    .run_id = atoi(runs[i]->d_name + 4),
+                };
+                files += scan(directory, &source, state);
+            }
+            free(configurations[j]);
+        }
+        if (count >= 0) {
+            free(configurations);
+        }
+        free(runs[i]);
+    }
+    free(runs);
+    return files;
+}
+
+struct latency_scan {
+    result_select_fn select;
+    void            *user;
+};
+
+// Raw samples take precedence, the histogram of a run only holds the same data bucketed
+static int scan_latency_directory(const char *directory, const struct result_source *source, void *state) {
+    struct latency_scan *scan = state;
+    struct select_cache cache = { .select = scan->select, .user = scan->user, .source = *source };
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.4000s/latencies.bin", directory);
+    if (access(path, R_OK) == 0) {
+        return scan_columnar(path, &cache);
+    }
+    snprintf(path, sizeof(path), "%.4000s/latencies.csv", directory);
+    if (access(path, R_OK) == 0) {
+        return scan_latency_csv(path, &cache);
+    }
+    snprintf(path, sizeof(path), "%.4000s/latency_histogram.bin", directory);
+    if (access(path, R_OK) == 0) {
+        return scan_histogram(path, &cache);
+    }
+    return 0;
+}
+
+int results_scan_latency(const char *experiment_path, const char *configuration,
+                         result_select_fn select, void *user) {
+    struct latency_scan scan = { .select = select, .user = user };
+    return results_for_each_run(experiment_path, configuration, scan_latency_directory, &scan);
+}
+
+struct throughput_scan {
+    result_throughput_fn callback;
+    void                *user;
+};
+
+static int scan_throughput_directory(const char *directory, const struct result_source *source, void *state) {
+    struct throughput_scan *scan = state;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.4000s/throughput.csv", directory);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[1024];
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return 0;
+    }
+    int threads_column = csv_column(line, "threads");
+    int work_size_column = csv_column(line, "work_size");
+    int ops_column = csv_column(line, "ops_per_sec");
+    if (work_size_column < 0 || ops_column < 0) {
+        fprintf(stderr, "Warning: Skipping unreadable result file %s\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    char *fields[CSV_MAX_FIELDS];
+    while (fgets(line, sizeof(line), file)) {
+        int count = csv_split(line, fields, CSV_MAX_FIELDS);
+        if (count <= ops_column || count <= work_size_column || count <= threads_column) {
+            continue;
+        }
+        uint32_t threads = threads_column >= 0 ? (uint32_t)strtoul(fields[threads_column], NULL, 10) : 1;
+        scan->callback(scan->user, source, threads, strtoull(fields[work_size_column], NULL, 10),
+                       strtod(fields[ops_column], NULL));
+    }
+    fclose(file);
+    return 1;
+}
+
+int results_scan_throughput(const char *experiment_path, const char *configuration,
+                            result_throughput_fn callback, void *user) {
+    struct throughput_scan scan = { .callback = callback, .user = user };
+    return results_for_each_run(experiment_path, configuration, scan_throughput_directory, &scan);
+}
+
+int results_scan_run_latency(const char *directory, const struct result_source *source,
+                             result_select_fn select, void *user) {
+    struct latency_scan scan = { .select = select, .user = user };
+    return scan_latency_directory(directory, source, &scan);
+}
+
+int results_scan_run_throughput(const char *directory, const struct result_source *source,
+                                result_throughput_fn callback, void *user) {
+    struct throughput_scan scan = { .callback = callback, .user = user };
+    return scan_throughput_directory(directory, source, &scan);
+}
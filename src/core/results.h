@@ -0,0 +1,108 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+#include <stdint.h>
+#include <stddef.h>
+
+// Latency sketches use the log-linear bucketing of the benchmark template's histograms.
+// Three significant digits keep every quantile within 0.1% of the exact sample value
+// while memory stays constant no matter how many samples are streamed in.
+#define SKETCH_SUB_BUCKET_HALF_MAGNITUDE 10
+#define SKETCH_SUB_BUCKET_HALF_COUNT     (1 << SKETCH_SUB_BUCKET_HALF_MAGNITUDE)
+#define SKETCH_SUB_BUCKET_MASK           ((1ULL << (SKETCH_SUB_BUCKET_HALF_MAGNITUDE + 1)) - 1)
+#define SKETCH_CHUNK_COUNT               (64 - SKETCH_SUB_BUCKET_HALF_MAGNITUDE + 1)
+
+// Streaming summary of latency samples. Values keep the unit of the result files they
+// come from (nanoseconds, or picoseconds for batched latency) so that integer samples stay
+// exact in the lowest buckets. Counts are indexed like the template's histogram and split
+// into chunks of half a bucket, which are only allocated once a sample falls into their range.
+struct sketch {
+    uint32_t  unit_ps;          // Picoseconds per recorded unit, set by the first file scanned into it
+    uint64_t  count;
+    uint64_t  min;
+    uint64_t  max;
+    uint64_t  shift;            // First value seen, sums are taken relative to it for stability
+    double    sum;
+    double    sum_squares;
+    uint64_t *chunks[SKETCH_CHUNK_COUNT];
+};
+
+void sketch_init(struct sketch *sketch);
+void sketch_free(struct sketch *sketch);
+void sketch_merge(struct sketch *into, const struct sketch *from);
+double sketch_mean(const struct sketch *sketch);
+double sketch_stddev(const struct sketch *sketch);
+uint64_t sketch_percentile(const struct sketch *sketch, double percentile);
+double sketch_to_ns(const struct sketch *sketch, double value);
+uint64_t sketch_value_at_index(int index);
+uint64_t *sketch_allocate_chunk(struct sketch *sketch, int chunk);
+
+static inline __attribute__((always_inline)) int sketch_index(uint64_t value) {
+    int bucket_index = 64 - __builtin_clzll(value | SKETCH_SUB_BUCKET_MASK) - (SKETCH_SUB_BUCKET_HALF_MAGNITUDE + 1);
+    int sub_bucket_index = (int)(value >> bucket_index);
+    return ((bucket_index + 1) << SKETCH_SUB_BUCKET_HALF_MAGNITUDE) + (sub_bucket_index - SKETCH_SUB_BUCKET_HALF_COUNT);
+}
+
+static inline __attribute__((always_inline)) void sketch_record_n(struct sketch *sketch, uint64_t value, uint64_t count) {
+    int index = sketch_index(value);
+    uint64_t *counts = sketch->chunks[index >> SKETCH_SUB_BUCKET_HALF_MAGNITUDE];
+    if (__builtin_expect(counts == NULL, 0)) {
+        counts = sketch_allocate_chunk(sketch, index >> SKETCH_SUB_BUCKET_HALF_MAGNITUDE);
+    }
+    counts[index & (SKETCH_SUB_BUCKET_HALF_COUNT - 1)] += count;
+
+    if (sketch->count == 0) {
+        sketch->shift = value;
+    }
+    double delta = (double)value - (double)sketch->shift;
+    sketch->sum += delta * count;
+    sketch->sum_squares += delta * delta * count;
+    sketch->count += count;
+    if (value < sketch->min) sketch->min = value;
+    if (value > sketch->max) sketch->max = value;
+}
+
+static inline __attribute__((always_inline)) void sketch_record(struct sketch *sketch, uint64_t value) {
+    sketch_record_n(sketch, value, 1);
+}
+
+// Identifies the run directory (data/raw/run_<id>/<configuration>) a result file belongs to
+struct result_source {
+    const char *configuration;
+    int         run_id;
+};
+
+// Returns the sketch that samples of one thread count and work size of a source are
+// recorded into, or NULL to skip them
+typedef struct sketch *(*result_select_fn)(void *user, const struct result_source *source,
+                                            uint32_t threads, uint64_t work_size);
+
+// Called for every row of a throughput.csv file
+typedef void (*result_throughput_fn)(void *user, const struct result_source *source,
+                                     uint32_t threads, uint64_t work_size, double ops_per_sec);
+
+// Called for every data/raw/run_<id>/<configuration> directory, returns the number of files it read
+typedef int (*result_run_fn)(const char *directory, const struct result_source *source, void *user);
+
+// Calls the function for the directory of every run, in run ID order, optionally only those
+// of one configuration. Returns the sum of its return values, or -1 if there is no data directory.
+int results_for_each_run(const char *experiment_path, const char *configuration,
+                         result_run_fn scan, void *user);
+
+// Streams every latency result below <experiment>/data/raw once. Raw samples are read
+// from latencies.bin or latencies.csv, otherwise the bucket counts of latency_histogram.bin
+// are merged. A NULL configuration scans all of them. Returns the number of files read,
+// or -1 if the data directory cannot be opened.
+int results_scan_latency(const char *experiment_path, const char *configuration,
+                         result_select_fn select, void *user);
+
+// Streams the throughput.csv file of every run, returns the number of files read
+int results_scan_throughput(const char *experiment_path, const char *configuration,
+                            result_throughput_fn callback, void *user);
+
+// Stream the results of a single run directory
+int results_scan_run_latency(const char *directory, const struct result_source *source,
+                             result_select_fn select, void *user);
+int results_scan_run_throughput(const char *directory, const struct result_source *source,
+                                result_throughput_fn callback, void *user);
+
+#endif // RESULTS_H
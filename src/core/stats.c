@@ -0,0 +1,393 @@
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+static void *checked_malloc(size_t size) {
+    void *memory = malloc(size ? size : 1);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Lists the non-empty buckets of a sketch as ascending picosecond values, clamped to the
+// sketch's exact minimum and maximum
+static int sketch_buckets(const struct sketch *sketch, uint64_t *values, uint64_t *counts) {
+    int length = 0;
+    for (int i = 0; i < SKETCH_CHUNK_COUNT; ++i) {
+        for (int j = 0; sketch->chunks[i] && j < SKETCH_SUB_BUCKET_HALF_COUNT; ++j) {
+            if (sketch->chunks[i][j] == 0) {
+                continue;
+            }
+            uint64_t value = sketch_value_at_index((i << SKETCH_SUB_BUCKET_HALF_MAGNITUDE) + j);
+            if (value < sketch->min) value = sketch->min;
+            if (value > sketch->max) value = sketch->max;
+            if (values) values[length] = value * sketch->unit_ps;
+            if (counts) counts[length] = sketch->chunks[i][j];
+            length++;
+        }
+    }
+    return length;
+}
+
+void sample_set_build(struct sample_set *set, struct sketch *const *runs, int run_count) {
+    memset(set, 0, sizeof(*set));
+    set->run_count = run_count;
+    set->runs = calloc(run_count, sizeof(struct run_counts));
+
+    // Collect the bucket values of every run, then keep the distinct ones
+    int capacity = 0;
+    for (int r = 0; r < run_count; ++r) {
+        capacity += sketch_buckets(runs[r], NULL, NULL);
+    }
+    uint64_t *values = checked_malloc(capacity * sizeof(uint64_t));
+    uint64_t **run_values = checked_malloc(run_count * sizeof(uint64_t *));
+    int length = 0;
+    for (int r = 0; r < run_count; ++r) {
+        struct run_counts *run = &set->runs[r];
+        run->length = sketch_buckets(runs[r], NULL, NULL);
+        run->index = checked_malloc(run->length * sizeof(uint32_t));
+        run->counts = checked_malloc(run->length * sizeof(uint64_t));
+        run_values[r] = values + length;
+        sketch_buckets(runs[r], run_values[r], run->counts);
+        run->total = runs[r]->count;
+        length += run->length;
+    }
+
+    uint64_t *distinct = checked_malloc(capacity * sizeof(uint64_t));
+    memcpy(distinct, values, capacity * sizeof(uint64_t));
+    qsort(distinct, capacity, sizeof(uint64_t), compare_u64);
+    set->length = 0;
+    for (int i = 0; i < capacity; ++i) {
+        if (set->length == 0 || distinct[set->length - 1] != distinct[i]) {
+            distinct[set->length++] = distinct[i];
+        }
+    }
+    set->values = distinct;
+    set->counts = calloc(set->length ? set->length : 1, sizeof(uint64_t));
+
+    for (int r = 0; r < run_count; ++r) {
+        struct run_counts *run = &set->runs[r];
+        for (int i = 0; i < run->length; ++i) {
+            uint64_t *found = bsearch(&run_values[r][i], set->values, set->length, sizeof(uint64_t), compare_u64);
+            run->index[i] = (uint32_t)(found - set->values);
+            set->counts[run->index[i]] += run->counts[i];
+        }
+        set->total += run->total;
+    }
+
+    free(run_values);
+    free(values);
+}
+
+void sample_set_free(struct sample_set *set) {
+    for (int r = 0; r < set->run_count; ++r) {
+        free(set->runs[r].index);
+        free(set->runs[r].counts);
+    }
+    free(set->runs);
+    free(set->values);
+    free(set->counts);
+    memset(set, 0, sizeof(*set));
+}
+
+uint64_t sample_set_percentile(const struct sample_set *set, const uint64_t *counts, uint64_t total, double percentile) {
+    uint64_t count_at_percentile = (uint64_t)(percentile / 100.0 * total + 0.5);
+    if (count_at_percentile < 1) {
+        count_at_percentile = 1;
+    }
+
+    uint64_t running_count = 0;
+    for (int i = 0; i < set->length; ++i) {
+        running_count += counts[i];
+        if (running_count >= count_at_percentile) {
+            return set->values[i];
+        }
+    }
+    return set->length ? set->values[set->length - 1] : 0;
+}
+
+static void mann_whitney_finish(double u, double a_count, double b_count, double tie_sum, struct mann_whitney *result) {
+    double n = a_count + b_count;
+    double mean = a_count * b_count / 2;
+    double variance = a_count * b_count / 12 * ((n + 1) - tie_sum / (n * (n - 1)));
+    result->u = u;
+    result->z = variance > 0 ? (u - mean) / sqrt(variance) : 0;
+    result->p_value = erfc(fabs(result->z) / sqrt(2));
+    result->superiority = a_count * b_count > 0 ? u / (a_count * b_count) : 0.5;
+}
+
+// Both sets are already grouped into ascending distinct values, so ranks follow from one merge
+void mann_whitney_sets(const struct sample_set *a, const struct sample_set *b, struct mann_whitney *result) {
+    double u = 0, tie_sum = 0, a_below = 0;
+    int i = 0, j = 0;
+    while (i < a->length || j < b->length) {
+        uint64_t value = (j >= b->length || (i < a->length && a->values[i] < b->values[j])) ? a->values[i] : b->values[j];
+        double a_ties = (i < a->length && a->values[i] == value) ? (double)a->counts[i++] : 0;
+        double b_ties = (j < b->length && b->values[j] == value) ? (double)b->counts[j++] : 0;
+        u += b_ties * (a_below + a_ties / 2);
+        a_below += a_ties;
+        double ties = a_ties + b_ties;
+        tie_sum += ties * ties * ties - ties;
+    }
+    mann_whitney_finish(u, (double)a->total, (double)b->total, tie_sum, result);
+}
+
+void mann_whitney_values(const double *a, int a_count, const double *b, int b_count, struct mann_whitney *result) {
+    double *sorted_a = checked_malloc(a_count * sizeof(double));
+    double *sorted_b = checked_malloc(b_count * sizeof(double));
+    memcpy(sorted_a, a, a_count * sizeof(double));
+    memcpy(sorted_b, b, b_count * sizeof(double));
+    qsort(sorted_a, a_count, sizeof(double), compare_double);
+    qsort(sorted_b, b_count, sizeof(double), compare_double);
+
+    double u = 0, tie_sum = 0, a_below = 0;
+    int i = 0, j = 0;
+    while (i < a_count || j < b_count) {
+        double value = (j >= b_count || (i < a_count && sorted_a[i] < sorted_b[j])) ? sorted_a[i] : sorted_b[j];
+        double a_ties = 0, b_ties = 0;
+        while (i < a_count && sorted_a[i] == value) { a_ties++; i++; }
+        while (j < b_count && sorted_b[j] == value) { b_ties++; j++; }
+        u += b_ties * (a_below + a_ties / 2);
+        a_below += a_ties;
+        double ties = a_ties + b_ties;
+        tie_sum += ties * ties * ties - ties;
+    }
+    mann_whitney_finish(u, a_count, b_count, tie_sum, result);
+
+    free(sorted_a);
+    free(sorted_b);
+}
+
+double quantile(double *values, int count, double q) {
+    if (count == 0) {
+        return NAN;
+    }
+    qsort(values, count, sizeof(double), compare_double);
+    double position = q * (count - 1);
+    int lower = (int)position;
+    if (lower >= count - 1) {
+        return values[count - 1];
+    }
+    return values[lower] + (position - lower) * (values[lower + 1] - values[lower]);
+}
+
+static inline uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline double uniform(uint64_t *state) {
+    return (splitmix64(state) >> 11) * 0x1.0p-53;
+}
+
+// Binomial variate. Small expected counts are drawn exactly by summing geometric gaps,
+// large ones through the normal approximation, so the cost does not grow with n.
+static uint64_t binomial(uint64_t *state, uint64_t n, double p) {
+    if (n == 0 || p <= 0) return 0;
+    if (p >= 1) return n;
+    if (p > 0.5) return n - binomial(state, n, 1 - p);
+
+    double mean = n * p;
+    if (mean < 30) {
+        double log_q = log1p(-p);
+        uint64_t successes = 0;
+        double trials = 0;
+        for (;;) {
+            trials += floor(log(1 - uniform(state)) / log_q) + 1;
+            if (trials > n) return successes;
+            successes++;
+        }
+    }
+
+    double u1 = 1 - uniform(state), u2 = uniform(state);
+    double gaussian = sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+    double x = floor(mean + sqrt(mean * (1 - p)) * gaussian + 0.5);
+    return x < 0 ? 0 : x > n ? n : (uint64_t)x;
+}
+
+// Adds a multinomial resample of one run to counts, drawn as a chain of conditional binomials
+static void resample_run(uint64_t *state, const struct run_counts *run, uint64_t *counts) {
+    uint64_t remaining = run->total;
+    uint64_t remaining_weight = run->total;
+    for (int i = 0; i < run->length && remaining > 0; ++i) {
+        uint64_t drawn = binomial(state, remaining, (double)run->counts[i] / remaining_weight);
+        counts[run->index[i]] += drawn;
+        remaining -= drawn;
+        remaining_weight -= run->counts[i];
+    }
+}
+
+static uint64_t resample_set(uint64_t *state, const struct sample_set *set, uint64_t *counts) {
+    memset(counts, 0, set->length * sizeof(uint64_t));
+    uint64_t total = 0;
+    for (int r = 0; r < set->run_count; ++r) {
+        const struct run_counts *run = &set->runs[splitmix64(state) % set->run_count];
+        resample_run(state, run, counts);
+        total += run->total;
+    }
+    return total;
+}
+
+struct bootstrap_task {
+    const struct sample_set *a;
+    const struct sample_set *b;
+    const double            *percentiles;
+    int                      percentile_count;
+    int                      first;
+    int                      last;
+    uint64_t                 seed;
+    double                  *changes;
+};
+
+static void *bootstrap_worker(void *arg) {
+    struct bootstrap_task *task = arg;
+    uint64_t *a_counts = checked_malloc(task->a->length * sizeof(uint64_t));
+    uint64_t *b_counts = checked_malloc(task->b->length * sizeof(uint64_t));
+
+    for (int replicate = task->first; replicate < task->last; ++replicate) {
+        uint64_t state = task->seed ^ ((uint64_t)replicate * 0xd1b54a32d192ed03ULL);
+        uint64_t a_total = resample_set(&state, task->a, a_counts);
+        uint64_t b_total = resample_set(&state, task->b, b_counts);
+        for (int p = 0; p < task->percentile_count; ++p) {
+            double a_value = sample_set_percentile(task->a, a_counts, a_total, task->percentiles[p]);
+            double b_value = sample_set_percentile(task->b, b_counts, b_total, task->percentiles[p]);
+            task->changes[replicate * task->percentile_count + p] = a_value > 0 ? b_value / a_value - 1 : 0;
+        }
+    }
+
+    free(a_counts);
+    free(b_counts);
+    return NULL;
+}
+
+void bootstrap_percentile_change(const struct sample_set *a, const struct sample_set *b,
+                                 const double *percentiles, int percentile_count,
+                                 int replicates, int threads, uint64_t seed, double *changes) {
+    if (threads < 1) threads = 1;
+    if (threads > replicates) threads = replicates;
+
+    pthread_t *handles = checked_malloc(threads * sizeof(pthread_t));
+    int *started = calloc(threads, sizeof(int));
+    struct bootstrap_task *tasks = checked_malloc(threads * sizeof(struct bootstrap_task));
+    for (int t = 0; t < threads; ++t) {
+        tasks[t] = (struct bootstrap_task){
+            .a = a, .b = b,
+            .percentiles = percentiles, .percentile_count = percentile_count,
+            .first = (int)((int64_t)replicates * t / threads),
+            .last = (int)((int64_t)replicates * (t + 1) / threads),
+            .seed = seed, .changes = changes,
+        };
+    }
+
+    // The calling thread takes the first slice, slices whose thread cannot be started run after it
+    for (int t = 1; t < threads; ++t) {
+        started[t] = pthread_create(&handles[t], NULL, bootstrap_worker, &tasks[t]) == 0;
+    }
+    for (int t = 0; t < threads; ++t) {
+        if (started[t]) {
+            pthread_join(handles[t], NULL);
+        } else {
+            bootstrap_worker(&tasks[t]);
+        }
+    }
+
+    free(handles);
+    free(started);
+    free(tasks);
+}
+
+void bootstrap_mean_change(const double *a, int a_count, const double *b, int b_count,
+                           int replicates, uint64_t seed, double *changes) {
+    for (int replicate = 0; replicate < replicates; ++replicate) {
+        uint64_t state = seed ^ ((uint64_t)replicate * 0xd1b54a32d192ed03ULL);
+        double a_sum = 0, b_sum = 0;
+        for (int i = 0; i < a_count; ++i) a_sum += a[splitmix64(&state) % a_count];
+        for (int i = 0; i < b_count; ++i) b_sum += b[splitmix64(&state) % b_count];
+        double a_mean = a_sum / a_count, b_mean = b_sum / b_count;
+        changes[replicate] = a_mean > 0 ? b_mean / a_mean - 1 : 0;
+    }
+}
+
+#define CUSUM_MIN_SEGMENT 3
+
+static double series_noise(const double *values, int count) {
+    if (count < 3) {
+        return 0;
+    }
+    double *differences = checked_malloc((count - 1) * sizeof(double));
+    double mean = 0;
+    for (int i = 0; i < count; ++i) {
+        mean += fabs(values[i]) / count;
+    }
+    for (int i = 1; i < count; ++i) {
+        differences[i - 1] = fabs(values[i] - values[i - 1]);
+    }
+    // The median absolute difference of normal noise is 0.954 sigma
+    double sigma = quantile(differences, count - 1, 0.5) / 0.954;
+    free(differences);
+
+    // Series that are flat most of the time still need a scale for their shifts
+    return sigma > mean * 1e-3 ? sigma : mean * 1e-3;
+}
+
+static void cusum_split(const double *values, int start, int end, double sigma, double threshold,
+                        int *points, int *found, int max_points) {
+    int length = end - start;
+    if (length < 2 * CUSUM_MIN_SEGMENT || *found == max_points) {
+        return;
+    }
+
+    double mean = 0;
+    for (int i = start; i < end; ++i) {
+        mean += values[i] / length;
+    }
+    double sum = 0, peak = 0;
+    int split = -1;
+    for (int i = start; i < end - CUSUM_MIN_SEGMENT; ++i) {
+        sum += values[i] - mean;
+        if (i + 1 - start >= CUSUM_MIN_SEGMENT && fabs(sum) > peak) {
+            peak = fabs(sum);
+            split = i + 1;
+        }
+    }
+    if (split < 0 || peak / (sigma * sqrt(length)) <= threshold) {
+        return;
+    }
+
+    points[(*found)++] = split;
+    cusum_split(values, start, split, sigma, threshold, points, found, max_points);
+    cusum_split(values, split, end, sigma, threshold, points, found, max_points);
+}
+
+static int compare_int(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+int cusum_change_points(const double *values, int count, double threshold, int *points, int max_points) {
+    double sigma = series_noise(values, count);
+    if (sigma <= 0) {
+        return 0;
+    }
+
+    int found = 0;
+    cusum_split(values, 0, count, sigma, threshold, points, &found, max_points);
+    qsort(points, found, sizeof(int), compare_int);
+    return found;
+}
@@ -0,0 +1,63 @@
+#ifndef STATS_H
+#define STATS_H
+#include <stdint.h>
+#include "results.h"
+
+// Latency samples of one configuration and group, kept per run as counts over the distinct
+// sketch bucket values of all its runs. Values are in picoseconds so that configurations
+// measured in different units compare directly.
+struct run_counts {
+    int       length;           // Number of non-empty buckets of the run
+    uint32_t *index;            // Position of each bucket in the sample set's values
+    uint64_t *counts;
+    uint64_t  total;
+};
+
+struct sample_set {
+    int                length;  // Number of distinct values over all runs
+    uint64_t          *values;  // Ascending
+    uint64_t          *counts;  // Over all runs
+    uint64_t           total;
+    int                run_count;
+    struct run_counts *runs;
+};
+
+void sample_set_build(struct sample_set *set, struct sketch *const *runs, int run_count);
+void sample_set_free(struct sample_set *set);
+uint64_t sample_set_percentile(const struct sample_set *set, const uint64_t *counts, uint64_t total, double percentile);
+
+struct mann_whitney {
+    double u;                   // U statistic of the second sample
+    double z;
+    double p_value;             // Two-sided, normal approximation with tie correction
+    double superiority;         // P(b > a) + P(b == a) / 2
+};
+
+void mann_whitney_sets(const struct sample_set *a, const struct sample_set *b, struct mann_whitney *result);
+void mann_whitney_values(const double *a, int a_count, const double *b, int b_count, struct mann_whitney *result);
+
+// Two-level bootstrap of the relative change b / a - 1 of the given percentiles. Each replicate
+// resamples the runs of both sets with replacement and then the samples within every drawn run,
+// so run-to-run variation widens the intervals. Replicates are spread over the given number of
+// threads and seeded individually, so results do not depend on the thread count. Writes
+// replicates * percentile_count changes, replicate-major.
+void bootstrap_percentile_change(const struct sample_set *a, const struct sample_set *b,
+                                 const double *percentiles, int percentile_count,
+                                 int replicates, int threads, uint64_t seed, double *changes);
+
+// Bootstrap of the relative change of the mean of per-run values, such as throughput
+void bootstrap_mean_change(const double *a, int a_count, const double *b, int b_count,
+                           int replicates, uint64_t seed, double *changes);
+
+// Linearly interpolated quantile of values, which are sorted in place
+double quantile(double *values, int count, double q);
+
+// Finds level shifts in a series by binary segmentation on the CUSUM of its deviations from the
+// mean. A segment is split where the cumulative sum peaks if that peak, in units of noise * sqrt(n),
+// exceeds the threshold (1.36, 1.63 and 1.95 are the 5%, 1% and 0.1% levels for a series without
+// shifts). The noise level is estimated from the median difference of consecutive values, so that
+// the shifts themselves do not inflate it. Writes the index of the first value after every shift
+// in ascending order and returns how many were found.
+int cusum_change_points(const double *values, int count, double threshold, int *points, int max_points);
+
+#endif // STATS_H
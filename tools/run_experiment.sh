@@ -14,15 +14,392 @@ write_config_value() {
     sed -i "/^$key/c\\$key = $value" "$CONFIG_FILE_PATH"
 }
 
-# Function to update experiment_run_configuration in the config file
-update_experiment_run_configuration() {
-    local config_name="$1"
-    write_config_value "experiment_run_configuration" "$config_name"
+# Function to expand a CPU list such as "0-3,8" into one CPU per line
+expand_cpu_list() {
+    local list=$1
+    local parts part
+    IFS=',' read -r -a parts <<< "$list"
+    for part in "${parts[@]}"; do
+        if [[ "$part" == *-* ]]; then
+            seq "${part%-*}" "${part#*-}"
+        elif [ -n "$part" ]; then
+            echo "$part"
+        fi
+    done
+}
+
+# Function to split the usable CPUs into disjoint groups, one per parallel job.
+# Isolated CPUs are preferred when the kernel has any, and SMT siblings always
+# stay in the same group so that concurrent runs never share a physical core.
+compute_cpu_groups() {
+    local groups=$1
+    local cpu_list=${ISOLATE_CPUS:-$(cat /sys/devices/system/cpu/isolated 2>/dev/null)}
+    if [ -z "$cpu_list" ]; then
+        cpu_list=$(cat /sys/devices/system/cpu/online)
+    fi
+
+    local cores=()
+    local -A core_cpus
+    local cpu core
+    for cpu in $(expand_cpu_list "$cpu_list"); do
+        core=$(cat /sys/devices/system/cpu/cpu$cpu/topology/thread_siblings_list 2>/dev/null || echo "$cpu")
+        if [ -z "${core_cpus[$core]}" ]; then
+            cores+=("$core")
+            core_cpus[$core]=$cpu
+        else
+            core_cpus[$core]+=",$cpu"
+        fi
+    done
+
+    if [ "${#cores[@]}" -eq 0 ]; then
+        echo "Error: No usable CPUs found in '$cpu_list' for parallel runs."
+        exit 1
+    fi
+    if [ "$groups" -gt "${#cores[@]}" ]; then
+        echo "Warning: only ${#cores[@]} physical cores available, running ${#cores[@]} configurations at a time."
+        groups=${#cores[@]}
+    fi
+
+    local cores_per_group=$(( ${#cores[@]} / groups ))
+    CPU_GROUPS=()
+    local g i
+    for (( g = 0; g < groups; g++ )); do
+        local group=""
+        for (( i = g * cores_per_group; i < (g + 1) * cores_per_group; i++ )); do
+            group+="${group:+,}${core_cpus[${cores[$i]}]}"
+        done
+        CPU_GROUPS+=("$group")
+    done
+}
+
+# Function to change a sysfs setting for --isolate. The original value is remembered so that
+# restore_isolation can put it back, and every outcome is added to ISOLATION_RECORD.
+isolate_set() {
+    local path=$1
+    local value=$2
+    if [ ! -e "$path" ]; then
+        ISOLATION_RECORD+=("$path: not available")
+        return
+    fi
+
+    local original=$(cat "$path" 2>/dev/null)
+    if [ "$original" = "$value" ]; then
+        ISOLATION_RECORD+=("$path: $value (unchanged)")
+    elif echo "$value" 2>/dev/null > "$path"; then
+        ISOLATION_ORIGINAL+=("$path=$original")
+        ISOLATION_RECORD+=("$path: $original -> $value")
+    else
+        ISOLATION_RECORD+=("$path: $original (not permitted)")
+    fi
+}
+
+# Function to undo every change made by isolate_set, in reverse order
+restore_isolation() {
+    local i entry
+    for (( i = ${#ISOLATION_ORIGINAL[@]} - 1; i >= 0; i-- )); do
+        entry=${ISOLATION_ORIGINAL[$i]}
+        if ! echo "${entry#*=}" 2>/dev/null > "${entry%%=*}"; then
+            echo "Warning: failed to restore ${entry%%=*} to ${entry#*=}"
+        fi
+    done
+    ISOLATION_ORIGINAL=()
+}
+
+# Function to prepare the machine for --isolate: choose the CPUs runs are pinned to, set their
+# governor to performance and optionally disable turbo. With --no-smt only the first CPU of
+# each core is kept and its siblings are taken offline, so runs never share a physical core.
+# Settings are restored when the script exits, including on SIGINT, SIGTERM and SIGHUP.
+isolate_machine() {
+    local cpu sibling
+    if [ -z "$ISOLATE_CPUS" ]; then
+        ISOLATE_CPUS=$(cat /sys/devices/system/cpu/isolated 2>/dev/null)
+    fi
+    if [ -z "$ISOLATE_CPUS" ]; then
+        # Without isolated CPUs, keep off the core of CPU 0, which handles most housekeeping
+        local -A excluded
+        for cpu in $(expand_cpu_list "$(cat /sys/devices/system/cpu/cpu0/topology/thread_siblings_list 2>/dev/null || echo 0)"); do
+            excluded[$cpu]=1
+        done
+        for cpu in $(expand_cpu_list "$(cat /sys/devices/system/cpu/online)"); do
+            if [ -z "${excluded[$cpu]}" ]; then
+                ISOLATE_CPUS+="${ISOLATE_CPUS:+,}$cpu"
+            fi
+        done
+        ISOLATE_CPUS=${ISOLATE_CPUS:-$(cat /sys/devices/system/cpu/online)}
+    fi
+    if [ "$ISOLATE_NO_SMT" -eq 1 ]; then
+        local -A seen_cores
+        local kept="" core
+        for cpu in $(expand_cpu_list "$ISOLATE_CPUS"); do
+            core=$(cat /sys/devices/system/cpu/cpu$cpu/topology/thread_siblings_list 2>/dev/null || echo "$cpu")
+            if [ -z "${seen_cores[$core]}" ]; then
+                seen_cores[$core]=1
+                kept+="${kept:+,}$cpu"
+            fi
+        done
+        ISOLATE_CPUS=$kept
+    fi
+
+    trap restore_isolation EXIT
+
+    ISOLATION_RECORD=("cpus: $ISOLATE_CPUS")
+    local -A pinned
+    for cpu in $(expand_cpu_list "$ISOLATE_CPUS"); do
+        pinned[$cpu]=1
+    done
+    for cpu in $(expand_cpu_list "$ISOLATE_CPUS"); do
+        isolate_set "/sys/devices/system/cpu/cpu$cpu/cpufreq/scaling_governor" performance
+        if [ "$ISOLATE_NO_SMT" -eq 1 ]; then
+            for sibling in $(expand_cpu_list "$(cat /sys/devices/system/cpu/cpu$cpu/topology/thread_siblings_list 2>/dev/null)"); do
+                if [ -z "${pinned[$sibling]}" ]; then
+                    isolate_set "/sys/devices/system/cpu/cpu$sibling/online" 0
+                fi
+            done
+        fi
+    done
+
+    if [ "$ISOLATE_NO_TURBO" -eq 1 ]; then
+        if [ -e /sys/devices/system/cpu/intel_pstate/no_turbo ]; then
+            isolate_set /sys/devices/system/cpu/intel_pstate/no_turbo 1
+        else
+            isolate_set /sys/devices/system/cpu/cpufreq/boost 0
+        fi
+    fi
+
+    # The benchmark locks its memory and switches to SCHED_FIFO itself
+    export EXPERIMENT_ISOLATE=true
+    ISOLATION_RECORD+=("process: mlockall, SCHED_FIFO (see run.log)")
+
+    printf '%s\n' "${ISOLATION_RECORD[@]}" | sed 's/^/Isolation: /'
+}
+
+# Function to run one phase of a configuration's run script at the current verbosity.
+# The benchmark's stdout is saved to the given log, output of parallel runs is
+# prefixed with the configuration name.
+run_configuration_script() {
+    local config=$1
+    local phase=$2
+    local log=$3
+    shift 3
+    local script="$EXPERIMENT_DIR/scripts/run_$config.sh"
+    local prefix=""
+    if [ "$PARALLEL_JOBS" -gt 1 ]; then
+        prefix="[$config] "
+    fi
+
+    case $VERBOSE_LEVEL in
+        0) "$@" "$script" $phase 2>/dev/null >"$log" ;;
+        1) "$@" "$script" $phase 2>/dev/null | tee "$log" | sed "s/^/$prefix/"; return ${PIPESTATUS[0]} ;;
+        2) "$@" "$script" $phase 2>&1 | tee "$log" | sed "s/^/$prefix/"; return ${PIPESTATUS[0]} ;;
+    esac
+}
+
+# Function to print the distinct contents of one or more sysfs files as a comma-separated list
+read_sysfs_values() {
+    local values=$(cat "$@" 2>/dev/null | sort -u | paste -sd, -)
+    echo "${values:-not available}"
+}
+
+# Function to print the manifest of one run in INI format. It fingerprints the machine,
+# the build and the configuration so that environment drift between runs can be told
+# apart from real changes in the results.
+write_manifest() {
+    local config=$1
+    local run_id=$2
+    local cpus=$3
+    local started=$4
+    local finished=$5
+    local status=$6
+    local cpu_dir=/sys/devices/system/cpu
+
+    echo "[run]"
+    echo "run_id = $run_id"
+    echo "configuration = $config"
+    echo "started = $started"
+    echo "finished = $finished"
+    echo "exit_status = $status"
+    echo "cpus = ${cpus:-all}"
+    echo "hostname = $(hostname)"
+
+    echo
+    echo "[machine]"
+    local model=$(awk -F ': ' '/^model name/ { print $2; exit }' /proc/cpuinfo)
+    echo "cpu_model = ${model:-$(lscpu | sed -n 's/^Model name: *//p')}"
+    echo "microcode = $(awk -F ': ' '/^microcode/ { print $2; exit }' /proc/cpuinfo)"
+    echo "cpus_online = $(cat $cpu_dir/online)"
+    echo "freq_min_khz = $(read_sysfs_values $cpu_dir/cpu*/cpufreq/cpuinfo_min_freq)"
+    echo "freq_max_khz = $(read_sysfs_values $cpu_dir/cpu*/cpufreq/cpuinfo_max_freq)"
+    echo "freq_base_khz = $(read_sysfs_values $cpu_dir/cpu*/cpufreq/base_frequency)"
+    echo "governor = $(read_sysfs_values $cpu_dir/cpu*/cpufreq/scaling_governor)"
+    if [ -f $cpu_dir/intel_pstate/no_turbo ]; then
+        echo "turbo = $( [ "$(cat $cpu_dir/intel_pstate/no_turbo)" -eq 0 ] && echo enabled || echo disabled)"
+    elif [ -f $cpu_dir/cpufreq/boost ]; then
+        echo "turbo = $( [ "$(cat $cpu_dir/cpufreq/boost)" -eq 1 ] && echo enabled || echo disabled)"
+    else
+        echo "turbo = not available"
+    fi
+    echo "smt = $(read_sysfs_values $cpu_dir/smt/control)"
+    echo "transparent_hugepages = $(sed -n 's/.*\[\(.*\)\].*/\1/p' /sys/kernel/mm/transparent_hugepage/enabled 2>/dev/null)"
+    echo "memory = $(awk '/^MemTotal/ { print $2 " " $3 }' /proc/meminfo)"
+    echo "kernel = $(uname -r)"
+    echo "kernel_cmdline = $(cat /proc/cmdline 2>/dev/null)"
+    echo "os = $(. /etc/os-release 2>/dev/null && echo "$PRETTY_NAME")"
+
+    # Written by the experiment Makefile next to the configuration's binary
+    echo
+    if [ -f "$EXPERIMENT_DIR/bin/$config/build.ini" ]; then
+        cat "$EXPERIMENT_DIR/bin/$config/build.ini"
+    else
+        echo "[build]"
+        echo "expconfig = not recorded"
+    fi
+
+    echo
+    echo "[source]"
+    if git -C "$EXPERIMENT_DIR" rev-parse --is-inside-work-tree >/dev/null 2>&1; then
+        echo "git_commit = $(git -C "$EXPERIMENT_DIR" rev-parse HEAD 2>/dev/null)"
+        echo "git_src_tree = $(git -C "$EXPERIMENT_DIR" rev-parse -q --verify HEAD:./src || echo "not committed")"
+        echo "git_src_modified = $(git -C "$EXPERIMENT_DIR" status --porcelain -- src | grep -q . && echo yes || echo no)"
+    else
+        echo "git_commit = not a git repository"
+    fi
+
+    # Machine changes made by --isolate
+    if [ "$ISOLATE" -eq 1 ]; then
+        echo
+        echo "[isolation]"
+        printf '%s\n' "${ISOLATION_RECORD[@]}" | sed 's/: / = /'
+    fi
+
+    # The configuration file as it was when the run finished, sections prefixed with "config."
+    echo
+    sed 's/^\[\(.*\)\]$/[config.\1]/' "$CONFIG_FILE_PATH"
+}
+
+# Function to run a configuration and write the manifest of the run once it finishes
+record_run() {
+    local config=$1
+    local run_id=$2
+    local cpus=$3
+    shift 3
+    local started=$(date -Iseconds)
+    "$@"
+    local status=$?
+    write_manifest "$config" "$run_id" "$cpus" "$started" "$(date -Iseconds)" "$status" \
+        > "$EXPERIMENT_DIR/data/raw/run_$run_id/$config/manifest.ini"
+    return $status
+}
+
+# Function to print the throughput of every (threads, work_size) group of a run directory,
+# one "group value" line each. Reads throughput.csv and falls back to the run log, whose
+# groups are told apart by their position, for benchmarks built before the data file existed
+read_run_throughput() {
+    if [ -f "$1/throughput.csv" ]; then
+        awk -F, 'NR == 1 { for (i = 1; i <= NF; i++) { if ($i == "ops_per_sec") col = i; if ($i == "threads") tcol = i
+                                                       if ($i == "work_size") wcol = i }
+                           next }
+                 col { printf "%s:%s %s\n", tcol ? $tcol : 1, $wcol, $col }' "$1/throughput.csv"
+    else
+        awk '/^Throughput/ { print "row" n++, $3 }' "$1/run.log" 2>/dev/null
+    fi
+}
+
+# Function to compute the width of the 95% confidence interval of the mean of every group
+# of "group value" lines on stdin, relative to the group's mean, and print the widest one.
+# Groups are only comparable to themselves, so pooling a sweep would measure its shape
+# rather than its noise. Uses Student's t quantiles for small samples.
+ci_relative_width() {
+    awk 'BEGIN {
+             split("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 " \
+                   "2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 " \
+                   "2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", t, " ")
+         }
+         { n[$1]++; sum[$1] += $2; x[$1, n[$1]] = $2 }
+         END {
+             widest = -1
+             for (group in n) {
+                 if (n[group] < 2 || sum[group] == 0) { print "inf"; exit }
+                 mean = sum[group] / n[group]
+                 var = 0
+                 for (i = 1; i <= n[group]; i++) var += (x[group, i] - mean) ^ 2
+                 quantile = (n[group] - 1 <= 30) ? t[n[group] - 1] : 1.96
+                 width = 2 * quantile * sqrt(var / (n[group] - 1)) / sqrt(n[group]) / mean
+                 if (width > widest) widest = width
+             }
+             if (widest < 0) print "inf"; else printf "%f\n", widest
+         }'
+}
+
+# Function to start one repetition of a configuration, pinned to a free CPU group in parallel mode
+start_configuration_run() {
+    local config=$1
+    local run_id=$2
+    local log_dir="$EXPERIMENT_DIR/data/raw/run_$run_id/$config"
+    mkdir -p "$log_dir"
+
+    if [ "$PARALLEL_JOBS" -gt 1 ]; then
+        while [ "${#FREE_GROUPS[@]}" -eq 0 ]; do
+            reap_configuration
+        done
+
+        local group=${FREE_GROUPS[0]}
+        FREE_GROUPS=("${FREE_GROUPS[@]:1}")
+        echo "Executing run_$config.sh (run $run_id) on CPUs ${CPU_GROUPS[$group]}"
+        EXPERIMENT_RUN_ID=$run_id record_run "$config" "$run_id" "${CPU_GROUPS[$group]}" \
+            run_configuration_script "$config" --run-only "$log_dir/run.log" taskset -c "${CPU_GROUPS[$group]}" &
+        RUNNING_GROUP[$!]=$group
+        RUNNING_CONFIG[$!]=$config
+    else
+        echo "Executing run_$config.sh (run $run_id)"
+        local pin=()
+        if [ "$ISOLATE" -eq 1 ]; then
+            pin=(taskset -c "$ISOLATE_CPUS")
+        fi
+        if ! EXPERIMENT_RUN_ID=$run_id record_run "$config" "$run_id" "$ISOLATE_CPUS" \
+                run_configuration_script "$config" --run-only "$log_dir/run.log" "${pin[@]}"; then
+            echo "Error: Script run_$config.sh failed to execute successfully."
+            FAILED=1
+        fi
+    fi
+}
+
+# Function to wait for any running configuration and release its CPU group
+reap_configuration() {
+    local pid
+    wait -n -p pid
+    local status=$?
+    if [ "$status" -ne 0 ]; then
+        echo "Error: Script run_${RUNNING_CONFIG[$pid]}.sh failed to execute successfully."
+        FAILED=1
+    fi
+    FREE_GROUPS+=("${RUNNING_GROUP[$pid]}")
+    unset "RUNNING_GROUP[$pid]" "RUNNING_CONFIG[$pid]"
+}
+
+# Function to print a process and all of its descendants
+process_tree() {
+    local child
+    echo "$1"
+    for child in $(pgrep -P "$1"); do
+        process_tree "$child"
+    done
+}
+
+# Function to kill every background job with its children. The whole tree is collected
+# first, as the children of a killed job are reparented and could no longer be found.
+kill_running_jobs() {
+    local job pids=()
+    for job in $(jobs -p); do
+        pids+=($(process_tree "$job"))
+    done
+    if [ "${#pids[@]}" -gt 0 ]; then
+        kill "${pids[@]}" 2>/dev/null
+    fi
 }
 
 # Check if at least one argument is provided
 if [ "$#" -lt 1 ]; then
-    echo "Usage: $0 <EXPERIMENT_DIR> [CONFIG_LIST]"
+    echo "Usage: $0 <EXPERIMENT_DIR> [CONFIG_LIST] [-v|-vv] [-j JOBS] [--ci-width WIDTH] [--isolate [--cpus LIST] [--no-turbo] [--no-smt]]"
     exit 1
 fi
 
@@ -54,38 +431,165 @@ else
     readarray -t CONFIGURATIONS < <(awk -F ' = ' '/experiment_configurations/ {gsub(/, /, "\n", $2); print $2}' "$CONFIG_FILE_PATH")
 fi
 
+# Remaining arguments are options
+shift $(( $# < 2 ? $# : 2 ))
 VERBOSE_LEVEL=0
-if [ "$3" == "-v" ]; then
-    VERBOSE_LEVEL=1
-elif [ "$3" == "-vv" ]; then
-    VERBOSE_LEVEL=2
+PARALLEL_JOBS=1
+CI_WIDTH=""
+ISOLATE=0
+ISOLATE_CPUS=""
+ISOLATE_NO_TURBO=0
+ISOLATE_NO_SMT=0
+MIN_ITERATIONS=5    # Repetitions required before the confidence interval may stop a configuration
+while [ "$#" -gt 0 ]; do
+    case "$1" in
+        -v)  VERBOSE_LEVEL=1 ;;
+        -vv) VERBOSE_LEVEL=2 ;;
+        -j)  PARALLEL_JOBS=$2; shift ;;
+        -j*) PARALLEL_JOBS=${1#-j} ;;
+        --ci-width) CI_WIDTH=$2; shift ;;
+        --isolate)  ISOLATE=1 ;;
+        --cpus)     ISOLATE_CPUS=$2; shift ;;
+        --no-turbo) ISOLATE_NO_TURBO=1 ;;
+        --no-smt)   ISOLATE_NO_SMT=1 ;;
+        *)   echo "Error: Unknown option '$1'"; exit 1 ;;
+    esac
+    shift
+done
+
+if [ "$ISOLATE" -eq 0 ] && { [ -n "$ISOLATE_CPUS" ] || [ "$ISOLATE_NO_TURBO" -eq 1 ] || [ "$ISOLATE_NO_SMT" -eq 1 ]; }; then
+    echo "Error: --cpus, --no-turbo and --no-smt require --isolate"
+    exit 1
 fi
 
-# Save the old config run value
-OLD_CONFIG_RUN=$(read_config_value "experiment_run_configuration")
+if [ -n "$ISOLATE_CPUS" ] && ! [[ "$ISOLATE_CPUS" =~ ^[0-9]+(-[0-9]+)?(,[0-9]+(-[0-9]+)?)*$ ]]; then
+    echo "Error: Invalid CPU list '$ISOLATE_CPUS'"
+    exit 1
+fi
+
+if ! [[ "$PARALLEL_JOBS" =~ ^[1-9][0-9]*$ ]]; then
+    echo "Error: Invalid number of parallel jobs '$PARALLEL_JOBS'"
+    exit 1
+fi
+
+# Parallel runs are reaped with wait -n -p, which needs bash 5.1
+if [ "$PARALLEL_JOBS" -gt 1 ] && (( BASH_VERSINFO[0] < 5 || (BASH_VERSINFO[0] == 5 && BASH_VERSINFO[1] < 1) )); then
+    echo "Error: -j requires bash 5.1 or later, this is bash $BASH_VERSION"
+    exit 1
+fi
 
+if [ -n "$CI_WIDTH" ] && ! [[ "$CI_WIDTH" =~ ^[0-9]*\.?[0-9]+$ ]]; then
+    echo "Error: Invalid confidence interval width '$CI_WIDTH'"
+    exit 1
+fi
+
+ITERATIONS=$(read_config_value "experiment_iterations")
+if ! [[ "$ITERATIONS" =~ ^[1-9][0-9]*$ ]]; then
+    ITERATIONS=1
+fi
+
+# Repetitions continue after the highest existing run ID so earlier results are never overwritten
+BASE_RUN_ID=$(read_config_value "experiment_run_id")
+BASE_RUN_ID=${BASE_RUN_ID:-0}
+for run_dir in "$EXPERIMENT_DIR"/data/raw/run_*; do
+    run_id=${run_dir##*/run_}
+    if [[ "$run_id" =~ ^[0-9]+$ ]] && [ "$run_id" -ge "$BASE_RUN_ID" ]; then
+        BASE_RUN_ID=$(( run_id + 1 ))
+    fi
+done
+
+# Configurations without a run script are reported and skipped
+ACTIVE_CONFIGURATIONS=()
 for config in "${CONFIGURATIONS[@]}"; do
-    update_experiment_run_configuration "$config"
-    RUN_SCRIPT_NAME=run_$config.sh
-    CONFIG_RUN_SCRIPT="$EXPERIMENT_DIR/scripts/$RUN_SCRIPT_NAME"
-
-    if [ -x "$CONFIG_RUN_SCRIPT" ]; then
-        echo "Executing $RUN_SCRIPT_NAME"
-        case $VERBOSE_LEVEL in
-            0) "$CONFIG_RUN_SCRIPT" &>/dev/null ;;
-            1) "$CONFIG_RUN_SCRIPT" 2>/dev/null ;;
-            2) "$CONFIG_RUN_SCRIPT" ;;
-            *) echo "Error: Invalid verbosity level" ;;
-        esac
-
-        if [ $? -ne 0 ]; then
-            echo "Error: Script $RUN_SCRIPT_NAME failed to execute successfully."
-            exit 3
-        fi
+    if [ -x "$EXPERIMENT_DIR/scripts/run_$config.sh" ]; then
+        ACTIVE_CONFIGURATIONS+=("$config")
     else
-        echo "Error: Configuration script $RUN_SCRIPT_NAME does not exist or is not executable."
+        echo "Error: Configuration script run_$config.sh does not exist or is not executable."
     fi
 done
 
-# Restore the old config run value
-write_config_value "experiment_run_configuration" "$OLD_CONFIG_RUN"
+# Background jobs of a non-interactive shell ignore SIGINT, so parallel builds and runs are
+# killed explicitly, including the benchmark processes they started. Exiting also runs the EXIT trap that undoes --isolate.
+if [ "$PARALLEL_JOBS" -gt 1 ] || [ "$ISOLATE" -eq 1 ]; then
+    trap 'kill_running_jobs; exit 130' INT TERM HUP
+fi
+
+# Every configuration is built once up front, concurrently in parallel mode
+echo "Building ${#ACTIVE_CONFIGURATIONS[@]} configurations"
+declare -A BUILD_PIDS
+for config in "${ACTIVE_CONFIGURATIONS[@]}"; do
+    if [ "$PARALLEL_JOBS" -gt 1 ]; then
+        run_configuration_script "$config" --build-only /dev/null &
+        BUILD_PIDS[$config]=$!
+    elif ! run_configuration_script "$config" --build-only /dev/null; then
+        echo "Error: Failed to build configuration $config."
+        exit 3
+    fi
+done
+for config in "${!BUILD_PIDS[@]}"; do
+    if ! wait "${BUILD_PIDS[$config]}"; then
+        echo "Error: Failed to build configuration $config."
+        exit 3
+    fi
+done
+
+# The machine is only reconfigured for the runs, builds are not affected
+if [ "$ISOLATE" -eq 1 ]; then
+    isolate_machine
+fi
+
+if [ "$PARALLEL_JOBS" -gt 1 ]; then
+    compute_cpu_groups "$PARALLEL_JOBS"
+    FREE_GROUPS=("${!CPU_GROUPS[@]}")
+fi
+declare -A RUNNING_GROUP RUNNING_CONFIG
+FAILED=0
+
+# Each repetition runs every remaining configuration once, in a fresh random order so
+# that slow drift of the machine state does not systematically favour one configuration
+iteration=0
+while [ "$iteration" -lt "$ITERATIONS" ] && [ "${#ACTIVE_CONFIGURATIONS[@]}" -gt 0 ]; do
+    run_id=$(( BASE_RUN_ID + iteration ))
+    echo "Repetition $(( iteration + 1 ))/$ITERATIONS (run ID $run_id)"
+
+    readarray -t ORDER < <(printf '%s\n' "${ACTIVE_CONFIGURATIONS[@]}" | shuf)
+    for config in "${ORDER[@]}"; do
+        start_configuration_run "$config" "$run_id"
+    done
+    while [ "${#RUNNING_GROUP[@]}" -gt 0 ]; do
+        reap_configuration
+    done
+    if [ "$FAILED" -ne 0 ]; then
+        write_config_value "experiment_run_id" "$(( run_id + 1 ))"
+        exit 3
+    fi
+
+    iteration=$(( iteration + 1 ))
+
+    # Early stop: drop configurations whose mean throughput is already known precisely enough
+    # at every thread count and work size
+    if [ -n "$CI_WIDTH" ] && [ "$iteration" -ge "$MIN_ITERATIONS" ]; then
+        REMAINING_CONFIGURATIONS=()
+        for config in "${ACTIVE_CONFIGURATIONS[@]}"; do
+            width=$(for (( i = 0; i < iteration; i++ )); do
+                        read_run_throughput "$EXPERIMENT_DIR/data/raw/run_$(( BASE_RUN_ID + i ))/$config"
+                    done | ci_relative_width)
+            if awk -v w="$width" -v target="$CI_WIDTH" 'BEGIN { exit !(w != "inf" && w < target) }'; then
+                echo "Stopping $config after $iteration repetitions (widest relative CI width $width)"
+            else
+                REMAINING_CONFIGURATIONS+=("$config")
+            fi
+        done
+        ACTIVE_CONFIGURATIONS=("${REMAINING_CONFIGURATIONS[@]}")
+    fi
+done
+
+# Advance the run ID so the next invocation starts after these repetitions
+write_config_value "experiment_run_id" "$(( BASE_RUN_ID + iteration ))"
+
+# Add the completed runs to the experiment's history store
+ARCHIPLEX="$(dirname "$0")/../bin/archiplex"
+[ -x "$ARCHIPLEX" ] || ARCHIPLEX=$(command -v archiplex)
+if [ -n "$ARCHIPLEX" ]; then
+    "$ARCHIPLEX" exp history "$(realpath "$EXPERIMENT_DIR")" --record || echo "Warning: Failed to record the runs in the history store"
+fi